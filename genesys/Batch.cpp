@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Batch.h"
+
+namespace {
+
+// the cases of one thread, the owner takes them from the front, the thieves from the back
+struct Part {
+   std::mutex _lock;
+   std::size_t _next = 0;
+   std::size_t _end = 0;
+};
+
+} // namespace
+
+//
+void Batch::addCase(const int* words, std::size_t count) {
+   _words.insert(_words.end(), words, words + count);
+   _starts.push_back(_words.size());
+}
+
+//
+void Batch::runCase(Interpreter& mach, Interpreter::Engine engine, std::size_t i) {
+   mach.reset();
+   mach.load(_words.data() + _starts[i], static_cast<int>(_starts[i + 1] - _starts[i]));
+   Result& res = _results[i];
+   res._count = mach.run(engine);
+   if (mach.status() != Interpreter::statusOk)
+      res._error = mach.errorText();
+}
+
+// the cases are short, so the thread takes them one by one - the lock of its own part is
+// uncontended till the others run out of theirs
+void Batch::run(Interpreter::Engine engine, unsigned threads) {
+   std::size_t cnt = size();
+   _results.assign(cnt, Result{ 0, std::string() });
+   if (!threads)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+   threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(cnt, 1)));
+
+   std::unique_ptr<Part[]> parts(new Part[threads]);
+   for (unsigned t = 0; t < threads; t++) {
+      parts[t]._next = cnt * t / threads;
+      parts[t]._end = cnt * (t + 1) / threads;
+   }
+
+   auto work = [&](unsigned self) {
+      Interpreter mach;
+      Part& own = parts[self];
+      for (;;) {
+         std::size_t i = 0;
+         bool found = false;
+         {
+            std::lock_guard<std::mutex> gl(own._lock);
+            if (own._next < own._end) {
+               i = own._next++;
+               found = true;
+            }
+         }
+         if (!found) {
+            // the busiest one
+            unsigned victim = self;
+            std::size_t most = 0;
+            for (unsigned t = 0; t < threads; t++) {
+               std::lock_guard<std::mutex> gl(parts[t]._lock);
+               if (parts[t]._end - parts[t]._next > most) {
+                  most = parts[t]._end - parts[t]._next;
+                  victim = t;
+               }
+            }
+            if (!most)
+               return;
+            std::size_t from = 0, to = 0;
+            {
+               std::lock_guard<std::mutex> gl(parts[victim]._lock);
+               Part& v = parts[victim];
+               if (v._next == v._end)
+                  continue; // taken meanwhile, look again
+               from = v._next + (v._end - v._next) / 2;
+               to = v._end;
+               v._end = from;
+            }
+            std::lock_guard<std::mutex> gl(own._lock);
+            own._next = from;
+            own._end = to;
+            continue;
+         }
+         runCase(mach, engine, i);
+      }
+   };
+
+   std::vector<std::thread> workers;
+   for (unsigned t = 1; t < threads; t++)
+      workers.emplace_back(work, t);
+   work(0);
+   for (auto& w : workers)
+      w.join();
+}
+
+//
+void Batch::print(std::ostream& out) const {
+   for (const Result& res : _results) {
+      if (!res._error.empty())
+         out << res._error << '\n';
+      out << res._count << '\n';
+   }
+   out.flush();
+}
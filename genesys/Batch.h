@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+
+// All the cases of the input, parsed before any of them runs. run() goes on the threads, every
+// thread has its own interpreter and its own part of the cases - when it's over, the thread steals
+// the upper half of the rest of the busiest one. The results are printed in the order of the input
+class Batch {
+public:
+   // the words of the next case, count <= Interpreter::memSize
+   void addCase(const int* words, std::size_t count);
+
+   std::size_t size() const { return _starts.size() - 1; }
+
+   // threads 0 - hardware threads
+   void run(Interpreter::Engine engine, unsigned threads = 0);
+
+   // as the sequential run does: the error line, if any, then the count
+   void print(std::ostream& out) const;
+
+private:
+   struct Result {
+      int _count;
+      std::string _error; // errorText() of the failed case
+   };
+
+   void runCase(Interpreter& mach, Interpreter::Engine engine, std::size_t i);
+
+   std::vector<int> _words; // of all the cases
+   std::vector<std::size_t> _starts{ 0 }; // case i is [_starts[i], _starts[i + 1]) of _words
+   std::vector<Result> _results;
+};
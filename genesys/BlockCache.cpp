@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include "BlockCache.h"
+
+namespace {
+
+// x = (x*m + a) % 1000 waiting to be emitted, m == 0 - the value is known
+struct Pending {
+   bool _has = false;
+   int _m = 1;
+   int _a = 0;
+
+   bool known() const { return _has && !_m; }
+
+   // then x = (x*m + a) % 1000
+   void apply(int m, int a) {
+      if (!_has) {
+         _has = true;
+         _m = 1;
+         _a = 0;
+      }
+      _m = _m * m % 1000;
+      _a = (_a * m + a) % 1000;
+   }
+};
+
+} // namespace
+
+//
+void BlockCache::reset() {
+   for (const Block& block : _blocks) {
+      _blockAt[block._begin] = -1;
+      std::fill(_compiled.begin() + block._begin, _compiled.begin() + block._begin + block._count, 0);
+   }
+   _blocks.clear();
+   _ops.clear();
+}
+
+// the immediate ops are kept in Pending of their register till something else reads it,
+// the store and the end of the block need all of them
+const BlockCache::Block& BlockCache::compile(int pc, const int* mem, int write) {
+   Block block{};
+   block._first = static_cast<std::uint32_t>(_ops.size());
+   block._begin = static_cast<std::uint16_t>(pc);
+   block._term = termEnd;
+
+   Pending pending[10];
+   auto emit = [&](SuperOp::Kind kind, int d, int s, int imm = 0, int imm2 = 0, int count = 0) {
+      _ops.push_back(SuperOp{ kind, static_cast<std::uint8_t>(d), static_cast<std::uint8_t>(s),
+         static_cast<std::uint16_t>(imm), static_cast<std::uint16_t>(imm2), static_cast<std::uint16_t>(count) });
+   };
+   auto flush = [&](int r) {
+      Pending& p = pending[r];
+      if (!p._has)
+         return;
+      if (!p._m)
+         emit(SuperOp::opSet, r, 0, p._a);
+      else if (p._m == 1) {
+         if (p._a)
+            emit(SuperOp::opAdd, r, 0, p._a);
+      }
+      else if (!p._a)
+         emit(SuperOp::opMul, r, 0, p._m);
+      else
+         emit(SuperOp::opAffine, r, 0, p._m, p._a);
+      p = Pending();
+   };
+   auto flushAll = [&]() {
+      for (int r = 0; r < 10; r++)
+         flush(r);
+   };
+
+   int count = 0;
+   for (; pc < write; pc++) {
+      int word = mem[pc];
+      int icod = word / 100;
+      int d = word / 10 % 10;
+      int s = word % 10;
+      _compiled[pc] = 1;
+      count++;
+
+      switch (icod) {
+      case 2: // 2dn
+         pending[d] = Pending();
+         pending[d].apply(0, s);
+         continue;
+
+      case 3: // 3dn
+         pending[d].apply(1, s);
+         continue;
+
+      case 4: // 4dn
+         pending[d].apply(s, 0);
+         continue;
+
+      case 5: // 5ds
+         if (d == s)
+            continue;
+         if (pending[s].known()) {
+            pending[d] = pending[s];
+            continue;
+         }
+         flush(s);
+         pending[d] = Pending();
+         emit(SuperOp::opMov, d, s);
+         continue;
+
+      case 6: // 6ds
+         if (d != s && pending[s].known()) {
+            pending[d].apply(1, pending[s]._a);
+            continue;
+         }
+         flush(d);
+         flush(s);
+         emit(SuperOp::opAddReg, d, s);
+         continue;
+
+      case 7: // 7ds
+         if (d != s && pending[s].known()) {
+            pending[d].apply(pending[s]._a, 0);
+            continue;
+         }
+         flush(d);
+         flush(s);
+         emit(SuperOp::opMulReg, d, s);
+         continue;
+
+      case 8: // 8da
+         flush(s);
+         pending[d] = Pending();
+         emit(SuperOp::opLoad, d, s);
+         continue;
+
+      case 9: // 9sa
+         flushAll();
+         // load of the stored register just before - the pair is one op
+         if (_ops.size() > block._first && _ops.back()._kind == SuperOp::opLoad && _ops.back()._d == d) {
+            SuperOp& load = _ops.back();
+            load._kind = SuperOp::opCopy;
+            load._imm = static_cast<std::uint16_t>(s);
+            load._count = static_cast<std::uint16_t>(count);
+         }
+         else
+            emit(SuperOp::opStore, d, s, 0, 0, count);
+         continue;
+
+      case 0: // 0ds
+         flushAll();
+         block._term = termJump;
+         block._d = static_cast<std::uint8_t>(d);
+         block._s = static_cast<std::uint8_t>(s);
+         break;
+
+      case 1: // 100, the rest is invalid
+         flushAll();
+         block._term = word == 100 ? termHalt : termInvalid;
+         break;
+      }
+      break;
+   }
+   if (block._term == termEnd)
+      flushAll();
+
+   block._last = static_cast<std::uint32_t>(_ops.size());
+   block._count = static_cast<std::uint16_t>(count);
+   _blockAt[block._begin] = static_cast<int>(_blocks.size());
+   _blocks.push_back(block);
+   return _blocks.back();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Compiled basic blocks of the loaded program, for Interpreter::runCompiled().
+// Jump targets are in the registers, so the block starts where the run enters it and ends with
+// the jump, halt or invalid instruction after it, or with the end of the program.
+// The instructions of the block are fused into superinstructions:
+//   - the immediate ops (2dn, 3dn, 4dn) of the register are folded into single x = (x*m + a) % 1000,
+//     so set+add, add chains and multiply-mod chains are one op, with one reduction;
+//   - 5ds, 6ds, 7ds with the register of known value are immediate ops too;
+//   - load followed by store of the loaded register is one op.
+// The folding needs all values in 0..999, so it's used just for the programs, whose words are
+// in 0..999 - then every register and RAM word stays in 0..999 and nothing can overflow.
+// The store to the word of the compiled block stops the compiled run (see SuperOp::opStore)
+class BlockCache {
+public:
+   // superinstruction
+   struct SuperOp {
+      enum Kind : std::uint8_t {
+         opSet,     // regs[d] = imm
+         opAdd,     // regs[d] = (regs[d] + imm) % 1000
+         opMul,     // regs[d] = regs[d] * imm % 1000
+         opAffine,  // regs[d] = (regs[d] * imm + imm2) % 1000
+         opMov,     // regs[d] = regs[s]
+         opAddReg,  // regs[d] = (regs[d] + regs[s]) % 1000
+         opMulReg,  // regs[d] = regs[d] * regs[s] % 1000
+         opLoad,    // regs[d] = mem[regs[s]]
+         opStore,   // mem[regs[s]] = regs[d], the registers are up to date before it
+         opCopy,    // regs[d] = mem[regs[s]]; mem[regs[imm]] = regs[d] - load/store pair
+      };
+
+      Kind _kind;
+      std::uint8_t _d;
+      std::uint8_t _s;
+      std::uint16_t _imm;
+      std::uint16_t _imm2;
+      std::uint16_t _count; // opStore, opCopy: instructions of the block till the store, including it
+   };
+
+   // how the block ends
+   enum Term : std::uint8_t {
+      termJump,    // 0ds, the last instruction
+      termHalt,    // 100
+      termInvalid, // 1pp with params, the last instruction
+      termEnd,     // the end of the program, no instruction
+   };
+
+   struct Block {
+      std::uint32_t _first; // ops in _ops
+      std::uint32_t _last;
+      std::uint16_t _begin; // address
+      std::uint16_t _count; // instructions, including the terminating one
+      Term _term;
+      std::uint8_t _d; // termJump: target register
+      std::uint8_t _s; //           condition register
+   };
+
+   BlockCache() {
+      _blockAt.fill(-1);
+      _compiled.fill(0);
+   }
+
+   void reset(); // drops the blocks, clears just their words
+
+   // block beginning at pc < write, compiled at the first call
+   const Block& at(int pc, const int* mem, int write) {
+      int idx = _blockAt[pc];
+      return idx >= 0 ? _blocks[idx] : compile(pc, mem, write);
+   }
+
+   const SuperOp* ops() const { return _ops.data(); }
+
+   // the word is an instruction of some compiled block
+   bool compiled(int addr) const { return _compiled[addr] != 0; }
+
+private:
+   const Block& compile(int pc, const int* mem, int write);
+
+   std::array<int, 1000> _blockAt; // address -> index in _blocks, -1 - not compiled
+   std::array<std::uint8_t, 1000> _compiled;
+   std::vector<Block> _blocks;
+   std::vector<SuperOp> _ops;
+};
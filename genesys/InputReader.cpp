@@ -0,0 +1,121 @@
+#include <climits>
+
+#include "InputReader.h"
+
+namespace {
+
+inline bool isSpace(char c) {
+   return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+   return static_cast<unsigned>(c - '0') < 10;
+}
+
+} // namespace
+
+// the stdin isn't a file for mapping always, so just the big blocks
+bool InputReader::readAll(std::FILE* file) {
+   const std::size_t block = 1 << 20;
+   _data.clear();
+   for (;;) {
+      std::size_t size = _data.size();
+      _data.resize(size + block);
+      std::size_t got = std::fread(_data.data() + size, 1, block, file);
+      _data.resize(size + got);
+      if (got < block)
+         break;
+   }
+   _pos = _data.data();
+   _end = _pos + _data.size();
+   _line = 1;
+   _first = true;
+   _error.clear();
+   return !std::ferror(file);
+}
+
+// as operator>>: skips the white space, the next line is the rest of the one with the number
+int InputReader::caseCount() {
+   while (_pos != _end && (isSpace(*_pos) || *_pos == '\n')) {
+      if (*_pos == '\n')
+         _line++;
+      _pos++;
+   }
+   bool neg = _pos != _end && *_pos == '-';
+   if (_pos != _end && (*_pos == '-' || *_pos == '+'))
+      _pos++;
+   long long num = 0;
+   for (; _pos != _end && isDigit(*_pos) && num <= INT_MAX; _pos++)
+      num = num * 10 + (*_pos - '0');
+   return num > INT_MAX ? 0 : static_cast<int>(neg ? -num : num);
+}
+
+//
+bool InputReader::lineBlank() const {
+   const char* p = _pos;
+   while (p != _end && isSpace(*p))
+      p++;
+   return p == _end || *p == '\n';
+}
+
+//
+void InputReader::skipLine() {
+   while (_pos != _end && *_pos != '\n')
+      _pos++;
+   if (_pos != _end) {
+      _pos++;
+      _line++;
+   }
+}
+
+//
+bool InputReader::fail(const char* what) {
+   _error = std::string(what) + " at line " + std::to_string(_line);
+   return false;
+}
+
+//
+bool InputReader::nextCase(int* words, int capacity, int& count) {
+   count = 0;
+   // there is a confusion in text descrption and example input
+   // lets tolerate for that
+   if (_first && lineBlank())
+      skipLine();
+   _first = false;
+
+   for (;;) {
+      // the common line: 3 digits and '\n'
+      if (_end - _pos >= 4 && isDigit(_pos[0]) && isDigit(_pos[1]) && isDigit(_pos[2]) && _pos[3] == '\n') {
+         if (count == capacity)
+            return fail("too many words");
+         words[count++] = (_pos[0] - '0') * 100 + (_pos[1] - '0') * 10 + (_pos[2] - '0');
+         _pos += 4;
+         _line++;
+         continue;
+      }
+      if (lineBlank()) {
+         skipLine();
+         return true;
+      }
+
+      const char* p = _pos;
+      while (isSpace(*p))
+         p++;
+      bool neg = *p == '-';
+      if (*p == '-' || *p == '+')
+         p++;
+      if (p == _end || !isDigit(*p))
+         return fail("invalid word");
+      long long num = 0;
+      for (; p != _end && isDigit(*p); p++) {
+         num = num * 10 + (*p - '0');
+         if (num > INT_MAX)
+            return fail("word out of range");
+      }
+      if (count == capacity)
+         return fail("too many words");
+      words[count++] = static_cast<int>(neg ? -num : num);
+      _pos = p;
+      skipLine();
+   }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// The input of genesys: the number of the cases, then the cases - one word per line,
+// the empty line ends the case. The whole input is read by big blocks first, then the words
+// are parsed right from the buffer, the common 3-digit line without any library call.
+// It reads the same as the original getline() + stoi() did:
+//   - the rest of the line with the number of the cases is the first line of the first case,
+//     if it's empty, the next one is;
+//   - the line may have spaces before the word, the sign, and anything after it;
+//   - the input ends the last case, the cases after the end are empty.
+// Lines with just spaces or '\r' are empty, so the files with "\r\n" read the same on every system
+class InputReader {
+public:
+   // all the file, false - read error
+   bool readAll(std::FILE* file);
+
+   // the first number of the input, 0 if there is none
+   int caseCount();
+
+   // the words of the next case, at most capacity of them. False - the error(), the words
+   // aren't numbers or there are too many of them
+   bool nextCase(int* words, int capacity, int& count);
+
+   const std::string& error() const { return _error; }
+
+private:
+   bool lineBlank() const; // the line at _pos has nothing but spaces
+   void skipLine();
+   bool fail(const char* what);
+
+   std::vector<char> _data;
+   const char* _pos = nullptr; // the beginning of the line, except after caseCount()
+   const char* _end = nullptr;
+   int _line = 1; // of _pos, for the errors
+   bool _first = true; // the next case is the first
+   std::string _error;
+};
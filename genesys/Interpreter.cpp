@@ -0,0 +1,500 @@
+#include <algorithm>
+
+#include "Interpreter.h"
+
+using namespace std::string_literals;
+
+// computed goto is GCC extension (clang has it too), MSVC goes with switch over decoded opcodes
+#if defined(__GNUC__)
+#define GENESYS_THREADED
+#endif
+
+//
+Interpreter::Interpreter() {
+   _mem.fill(0);
+   _ops.fill(Op{ codeEnd, 0, 0 });
+   _used = 0;
+   _decoded = 0;
+   reset();
+}
+
+// the interpreter runs thousands of short programs, they write few words of RAM
+void Interpreter::reset() { // reset the interpreter
+   for (int& cur : _regs)
+      cur = 0;
+   std::fill(_mem.begin(), _mem.begin() + _used, 0);
+   _used = 0;
+   _write = 0;
+   _exec = 0;
+   _halt = false;
+   _status = statusOk;
+   _errInstr = 0;
+   _errAddress = 0;
+}
+
+//
+void Interpreter::load(const int* words, int count) {
+   std::copy(words, words + count, _mem.begin() + _write);
+   _write += count;
+   if (_write > _used)
+      _used = _write;
+}
+
+//
+void Interpreter::loaded(int count) {
+   _write = count;
+   if (_write > _used)
+      _used = _write;
+}
+
+//
+int Interpreter::run(Engine engine) {
+   switch (engine) {
+   case engineSwitch: return run();
+   case engineDecoded: return runDecoded();
+   case engineCompiled: return runCompiled();
+   }
+   return 0;
+}
+
+//
+bool Interpreter::engineByName(const std::string& name, Engine& engine) {
+   if (name == "switch")
+      engine = engineSwitch;
+   else if (name == "decoded")
+      engine = engineDecoded;
+   else if (name == "compiled")
+      engine = engineCompiled;
+   else
+      return false;
+   return true;
+}
+
+//
+const char* Interpreter::statusText(Status status) {
+   switch (status) {
+   case statusOk: return "ok";
+   case statusInvalidInstruction: return "invalid instruction";
+   case statusInvalidAddress: return "invalid address";
+   }
+   return "unknown";
+}
+
+//
+std::string Interpreter::errorText() const {
+   return "error: '"s + statusText(_status) + "' executing: " + std::to_string(_errInstr) +
+      " at address: " + std::to_string(_errAddress);
+}
+
+//
+int Interpreter::run() { // reset the interpreter
+   int qntInstr = 0;
+   _status = statusOk;
+   while (!_halt && (_exec < _write)) { // let be safe still
+      int instr = _mem[_exec++];
+      try {
+         execute(instr);
+      }
+      catch (Status err) {
+         _status = err;
+         _errInstr = instr;
+         _errAddress = _exec - 1;
+         _halt = true;
+      }
+      qntInstr++;
+   }
+   return qntInstr;
+}
+
+// RAM address from register, it isn't always valid when the input has words out of 0..999
+static inline bool validAddress(int addr) {
+   return addr >= 0 && addr < Interpreter::memSize;
+}
+
+//
+void Interpreter::execute(int instr) {
+   if (instr < 0)
+      throw statusInvalidInstruction;
+
+   // parse instruction
+   int p2 = instr % 10;
+   instr /= 10;
+   int p1 = instr % 10;
+   int icod = instr / 10;
+
+   // for now we just go straight with switch.
+   // runDecoded() is the fast one, this is the reference for it
+   int tmp = 0;
+   switch (icod) {
+   case 1: // 100 means halt
+      // both params should be 0 // or we shell ignore their values
+      if (p2 || p1)
+         throw statusInvalidInstruction; // ???
+      _halt = true;
+      break;
+
+   case 2: // 2dn means set register d to n (between 0 and 9)
+      _regs[p1] = p2;
+      break;
+
+   case 3: // 3dn means add n to register d
+      tmp = _regs[p1] + p2;
+      _regs[p1] = tmp % 1000;
+      break;
+
+   case 4: // 4dn means multiply register d by n
+      tmp = _regs[p1] * p2;
+      _regs[p1] = tmp % 1000;
+      break;
+
+   case 5: // 5ds means set register d to the value of register s
+      _regs[p1] = _regs[p2];
+      break;
+
+   case 6: // 6ds means add the value of register s to register d
+      tmp = _regs[p1] + _regs[p2];
+      _regs[p1] = tmp % 1000;
+      break;
+
+   case 7: // 7ds means multiply register d by the value of register s
+      tmp = _regs[p1] * _regs[p2];
+      _regs[p1] = tmp % 1000;
+      break;
+
+   case 8: // 8da means set register d to the value in RAM whose address is in register a
+      if (!validAddress(_regs[p2]))
+         throw statusInvalidAddress;
+      _regs[p1] = _mem[_regs[p2]];
+      break;
+
+   case 9: // 9sa means set the value in RAM whose address is in register a to the value of register s
+      if (!validAddress(_regs[p2]))
+         throw statusInvalidAddress;
+      _mem[_regs[p2]] = _regs[p1];
+      if (_regs[p2] >= _used)
+         _used = _regs[p2] + 1;
+      break;
+
+   case 0: // 0ds means goto the location in register d unless register s contains 0
+      if (_regs[p2]) {
+         if (_regs[p1] < 0)
+            throw statusInvalidAddress;
+         _exec = _regs[p1];
+      }
+      break;
+
+   }
+}
+
+//
+Interpreter::Op Interpreter::decode(int word) {
+   if (word < 0)
+      return Op{ codeInvalid, 0, 0 };
+   int icod = word / 100;
+   if (icod > 9)
+      return Op{ codeNop, 0, 0 };
+   auto p1 = static_cast<std::uint8_t>(word / 10 % 10);
+   auto p2 = static_cast<std::uint8_t>(word % 10);
+   if (icod == codeHalt && (p1 || p2))
+      return Op{ codeInvalid, 0, 0 };
+   return Op{ static_cast<std::uint8_t>(icod), p1, p2 };
+}
+
+// the loaded program, the rest is codeEnd - so the dispatch needs no bounds check.
+// Past the last decoded program it's codeEnd already
+void Interpreter::decodeProgram() {
+   for (int i = 0; i < _write; i++)
+      _ops[i] = decode(_mem[i]);
+   for (int i = _write; i < _decoded; i++)
+      _ops[i] = Op{ codeEnd, 0, 0 };
+   _decoded = _write;
+}
+
+//
+void Interpreter::fail(Status status, int address) {
+   _status = status;
+   _errInstr = _mem[address];
+   _errAddress = address;
+}
+
+//
+int Interpreter::runDecoded() {
+   NoProfile none;
+   return runDecoded(none);
+}
+
+//
+int Interpreter::runProfiled(Profiler& prof) {
+   return runDecoded(prof);
+}
+
+// registers are local, so they aren't reloaded after every store to RAM.
+// The count goes up on the fetch, codeEnd takes it back.
+// The hooks of NoProfile are empty, the calls of them and the conditions around are gone
+template <class Prof>
+int Interpreter::runDecoded(Prof& prof) {
+   _status = statusOk;
+   if (_halt)
+      return 0;
+   decodeProgram();
+
+   int regs[regCount];
+   for (int i = 0; i < regCount; i++)
+      regs[i] = _regs[i];
+   int* mem = _mem.data();
+   int used = _used;
+   Op* ops = _ops.data();
+   int pc = std::min(_exec, static_cast<int>(memSize));
+   int qntInstr = 0;
+   int addr = 0;
+   const Op* op = nullptr;
+
+#define PROFILE_STEP() if (Prof::enabled && op->_code != codeEnd) prof.step(pc - 1, mem[pc - 1])
+#ifdef GENESYS_THREADED
+#define OP(code) op_##code:
+#define NEXT() do { op = &ops[pc++]; qntInstr++; PROFILE_STEP(); goto *labels[op->_code]; } while (0)
+   // in order of Code
+   static void* const labels[] = {
+      &&op_codeJump, &&op_codeHalt, &&op_codeSet, &&op_codeAdd, &&op_codeMul, &&op_codeMov, &&op_codeAddReg,
+      &&op_codeMulReg, &&op_codeLoad, &&op_codeStore, &&op_codeNop, &&op_codeInvalid, &&op_codeEnd
+   };
+   NEXT();
+#else
+#define OP(code) case code:
+#define NEXT() continue
+   for (;;) {
+      op = &ops[pc++];
+      qntInstr++;
+      PROFILE_STEP();
+      switch (op->_code) {
+#endif
+
+   OP(codeJump)
+      if (Prof::enabled)
+         prof.jump(pc - 1, regs[op->_p2] != 0);
+      if (regs[op->_p2]) {
+         addr = regs[op->_p1];
+         if (addr < 0) {
+            fail(statusInvalidAddress, pc - 1);
+            goto halt;
+         }
+         pc = addr < memSize ? addr : memSize;
+      }
+      NEXT();
+
+   OP(codeHalt)
+      goto halt;
+
+   OP(codeSet)
+      regs[op->_p1] = op->_p2;
+      NEXT();
+
+   OP(codeAdd)
+      regs[op->_p1] = (regs[op->_p1] + op->_p2) % 1000;
+      NEXT();
+
+   OP(codeMul)
+      regs[op->_p1] = regs[op->_p1] * op->_p2 % 1000;
+      NEXT();
+
+   OP(codeMov)
+      regs[op->_p1] = regs[op->_p2];
+      NEXT();
+
+   OP(codeAddReg)
+      regs[op->_p1] = (regs[op->_p1] + regs[op->_p2]) % 1000;
+      NEXT();
+
+   OP(codeMulReg)
+      regs[op->_p1] = regs[op->_p1] * regs[op->_p2] % 1000;
+      NEXT();
+
+   OP(codeLoad)
+      addr = regs[op->_p2];
+      if (!validAddress(addr)) {
+         fail(statusInvalidAddress, pc - 1);
+         goto halt;
+      }
+      if (Prof::enabled)
+         prof.read(addr);
+      regs[op->_p1] = mem[addr];
+      NEXT();
+
+   OP(codeStore)
+      addr = regs[op->_p2];
+      if (!validAddress(addr)) {
+         fail(statusInvalidAddress, pc - 1);
+         goto halt;
+      }
+      if (Prof::enabled)
+         prof.write(addr);
+      mem[addr] = regs[op->_p1];
+      if (addr >= used)
+         used = addr + 1;
+      if (addr < _write) // the program modifies itself
+         ops[addr] = decode(mem[addr]);
+      NEXT();
+
+   OP(codeNop)
+      NEXT();
+
+   OP(codeInvalid)
+      fail(statusInvalidInstruction, pc - 1);
+      goto halt;
+
+   OP(codeEnd)
+      qntInstr--;
+      pc--;
+      goto done;
+
+#ifndef GENESYS_THREADED
+      }
+   }
+#endif
+#undef OP
+#undef NEXT
+#undef PROFILE_STEP
+
+halt:
+   _halt = true;
+done:
+   for (int i = 0; i < regCount; i++)
+      _regs[i] = regs[i];
+   _exec = pc;
+   _used = used;
+   return qntInstr;
+}
+
+//
+bool Interpreter::inRange() const {
+   for (int word : _mem)
+      if (word < 0 || word >= 1000)
+         return false;
+   for (int r : _regs)
+      if (r < 0 || r >= 1000)
+         return false;
+   return true;
+}
+
+// the stores keep all in 0..999, so the sums need no division and the addresses need no check.
+// The blocks are compiled for this run
+int Interpreter::runCompiled() {
+   _status = statusOk;
+   if (_halt)
+      return 0;
+   if (!inRange())
+      return runDecoded();
+   _blocks.reset();
+
+   int regs[regCount];
+   for (int i = 0; i < regCount; i++)
+      regs[i] = _regs[i];
+   int* mem = _mem.data();
+   int used = _used;
+   const int write = _write;
+   int pc = _exec;
+   int qntInstr = 0;
+
+   while (pc < write) {
+      const BlockCache::Block& block = _blocks.at(pc, mem, write);
+      const BlockCache::SuperOp* first = _blocks.ops() + block._first;
+      const BlockCache::SuperOp* last = _blocks.ops() + block._last;
+      int addr = 0;
+      int tmp = 0;
+   again:
+      for (const BlockCache::SuperOp* op = first; op != last; op++) {
+         int& d = regs[op->_d];
+         switch (op->_kind) {
+         case BlockCache::SuperOp::opSet:
+            d = op->_imm;
+            break;
+
+         case BlockCache::SuperOp::opAdd:
+            tmp = d + op->_imm;
+            d = tmp >= 1000 ? tmp - 1000 : tmp;
+            break;
+
+         case BlockCache::SuperOp::opMul:
+            d = d * op->_imm % 1000;
+            break;
+
+         case BlockCache::SuperOp::opAffine:
+            d = (d * op->_imm + op->_imm2) % 1000;
+            break;
+
+         case BlockCache::SuperOp::opMov:
+            d = regs[op->_s];
+            break;
+
+         case BlockCache::SuperOp::opAddReg:
+            tmp = d + regs[op->_s];
+            d = tmp >= 1000 ? tmp - 1000 : tmp;
+            break;
+
+         case BlockCache::SuperOp::opMulReg:
+            d = d * regs[op->_s] % 1000;
+            break;
+
+         case BlockCache::SuperOp::opLoad:
+            d = mem[regs[op->_s]];
+            break;
+
+         case BlockCache::SuperOp::opCopy:
+            d = mem[regs[op->_s]];
+            addr = regs[op->_imm];
+            goto store;
+
+         case BlockCache::SuperOp::opStore:
+            addr = regs[op->_s];
+         store:
+            if (addr >= used)
+               used = addr + 1;
+            if (_blocks.compiled(addr) && mem[addr] != d) {
+               // the program modifies the compiled code, the rest goes word by word
+               mem[addr] = d;
+               qntInstr += op->_count;
+               for (int i = 0; i < regCount; i++)
+                  _regs[i] = regs[i];
+               _exec = block._begin + op->_count;
+               _used = used;
+               return qntInstr + runDecoded();
+            }
+            mem[addr] = d;
+            break;
+         }
+      }
+
+      qntInstr += block._count;
+      switch (block._term) {
+      case BlockCache::termJump:
+         pc = block._begin + block._count;
+         if (regs[block._s]) {
+            pc = regs[block._d];
+            if (pc == block._begin) // loop of single block
+               goto again;
+         }
+         continue;
+
+      case BlockCache::termHalt:
+         _halt = true;
+         break;
+
+      case BlockCache::termInvalid:
+         _halt = true;
+         fail(statusInvalidInstruction, block._begin + block._count - 1);
+         break;
+
+      case BlockCache::termEnd:
+         pc = write;
+         continue;
+      }
+      pc = block._begin + block._count;
+      break;
+   }
+
+   for (int i = 0; i < regCount; i++)
+      _regs[i] = regs[i];
+   _exec = pc;
+   _used = used;
+   return qntInstr;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "BlockCache.h"
+#include "Profiler.h"
+
+// The machine: 10 registers and 1000 words of RAM, every word is 3-digit instruction "icod p1 p2".
+// There are three engines, they give the same results:
+//   - run() - the original one, decodes every instruction as it goes and dispatches by switch;
+//   - runDecoded() - decodes the loaded program once into opcode/operands array and dispatches
+//     it by computed goto (GCC, clang), or by switch over the decoded opcode (MSVC).
+//     Stores (9sa) decode the stored word again, so the self-modifying programs work as before.
+//     The errors are status codes, not exceptions
+//   - runCompiled() - runs the basic blocks of superinstructions (see BlockCache), for the programs
+//     with all words in 0..999, the rest goes with runDecoded(). When the program stores into the
+//     instruction of the compiled block, the run goes on with runDecoded()
+// runProfiled() is runDecoded() with the hooks of Profiler, runDecoded() has the empty ones
+//
+// The words outside of the loaded program are never executed - the run stops when it gets there
+class Interpreter {
+public:
+   // result of the run, the error stops it
+   enum Status {
+      statusOk,                 // halted, or went out of the loaded program
+      statusInvalidInstruction, // 1pp with non-zero params, or negative word
+      statusInvalidAddress,     // RAM address or jump target, which isn't in 0..999
+   };
+
+   enum Engine {
+      engineSwitch,   // run()
+      engineDecoded,  // runDecoded()
+      engineCompiled, // runCompiled()
+   };
+
+   static const int memSize = 1000;
+   static const int regCount = 10;
+
+   Interpreter();
+
+   void reset(); // reset the interpreter, just the written RAM is cleared
+
+   void setNextMemory(int num) {
+      _mem[_write++] = num;
+      if (_write > _used)
+         _used = _write;
+   }
+
+   // the program after reset(), count <= memSize
+   void load(const int* words, int count);
+
+   // RAM for the program to be parsed right into after reset(), then loaded() with the number of the words
+   int* memory() { return _mem.data(); }
+   void loaded(int count);
+
+   // run content in memory, returns the number of the executed instructions,
+   // including the one, which has failed. The error is in status() and errorText()
+   int run();
+   int runDecoded();
+   int runCompiled();
+   int run(Engine engine);
+
+   // runDecoded() with the counts and the trace in prof, it isn't reset
+   int runProfiled(Profiler& prof);
+
+   // "switch", "decoded", "compiled"
+   static bool engineByName(const std::string& name, Engine& engine);
+
+   // of the last run
+   Status status() const { return _status; }
+
+   // "error: ..." line of the failed run, as the original engine prints it
+   std::string errorText() const;
+
+   static const char* statusText(Status status);
+
+private:
+   void execute(int instr);
+
+   // decoded instruction
+   struct Op {
+      std::uint8_t _code; // Code
+      std::uint8_t _p1;
+      std::uint8_t _p2;
+   };
+
+   // icod of the valid instructions, then the special ones
+   enum Code : std::uint8_t {
+      codeJump, codeHalt, codeSet, codeAdd, codeMul, codeMov, codeAddReg, codeMulReg, codeLoad, codeStore,
+      codeNop,     // icod > 9 - the original switch ignores it
+      codeInvalid, // fails as invalid instruction
+      codeEnd      // out of the loaded program
+   };
+
+   template <class Prof>
+   int runDecoded(Prof& prof);
+
+   static Op decode(int word);
+   void decodeProgram();
+   void fail(Status status, int address); // the error at the address
+   bool inRange() const; // all words and registers in 0..999
+
+   std::array<int, regCount> _regs; // registers
+   std::array<int, memSize> _mem; // RAM
+   std::array<Op, memSize + 1> _ops; // decoded _mem, codeEnd past the loaded program
+   int _decoded; // _ops past it are codeEnd
+   BlockCache _blocks; // of runCompiled()
+   int _write; // position where next setNextMemory() will happen
+   int _used; // RAM from 0 till here was written, reset() clears just it
+   int _exec; // position of next executing instruction
+   bool _halt; // executed halt command
+   Status _status; // of the last run
+   int _errInstr; // the failed instruction and its address
+   int _errAddress;
+};
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "Profiler.h"
+
+//
+void Profiler::reset() {
+   _execs.fill(0);
+   _taken.fill(0);
+   _notTaken.fill(0);
+   _reads.fill(0);
+   _writes.fill(0);
+   _opcodes.fill(0);
+   _steps = 0;
+}
+
+// the heatmap is 20 rows of 50 words, reads and writes together, log scale against the hottest word
+void Profiler::print(std::ostream& out) const {
+   static const char* const names[opcodeCount] = {
+      "0ds jump", "100 halt", "2dn set", "3dn add", "4dn mul", "5ds mov", "6ds add", "7ds mul", "8da load",
+      "9sa store", ">999", "negative"
+   };
+   out << "instructions: " << _steps << '\n';
+   for (int i = 0; i < opcodeCount; i++)
+      if (_opcodes[i])
+         out << "  " << std::left << std::setw(10) << names[i] << std::right << std::setw(12) << _opcodes[i] << '\n';
+
+   out << "address   executed      taken  not taken      reads     writes\n";
+   for (int a = 0; a < 1000; a++) {
+      if (!_execs[a] && !_reads[a] && !_writes[a])
+         continue;
+      out << std::setw(7) << a << std::setw(11) << _execs[a] << std::setw(11) << _taken[a]
+         << std::setw(11) << _notTaken[a] << std::setw(11) << _reads[a] << std::setw(11) << _writes[a] << '\n';
+   }
+
+   static const char scale[] = " .:-=+*#%@";
+   std::uint64_t hottest = 0;
+   for (int a = 0; a < 1000; a++)
+      hottest = std::max(hottest, _reads[a] + _writes[a]);
+   if (!hottest)
+      return;
+   out << "RAM reads+writes, 50 words per row, '@' - " << hottest << '\n';
+   for (int row = 0; row < 20; row++) {
+      out << std::setw(5) << row * 50 << ' ';
+      for (int a = row * 50; a < row * 50 + 50; a++) {
+         std::uint64_t cnt = _reads[a] + _writes[a];
+         int level = 0;
+         if (cnt)
+            level = hottest == 1 ? 9 : 1 + static_cast<int>(8 * std::log(static_cast<double>(cnt)) / std::log(static_cast<double>(hottest)));
+         out << scale[level];
+      }
+      out << '\n';
+   }
+}
+
+//
+void Profiler::writeTrace(std::ostream& out) const {
+   std::uint32_t cnt = static_cast<std::uint32_t>(std::min<std::uint64_t>(_steps, traceSize));
+   out.write("GTRC", 4);
+   out.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+   for (std::uint64_t s = _steps - cnt; s < _steps; s++)
+      out.write(reinterpret_cast<const char*>(&_trace[s & (traceSize - 1)]), sizeof(TraceEntry));
+}
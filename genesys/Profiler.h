@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+// Hooks of Interpreter::runDecoded(), the engine is a template on them:
+//   - NoProfile - all empty and enabled is false, so runDecoded() has no trace of them;
+//   - Profiler - counts of the executed instructions by address and by opcode, taken and not taken
+//     jumps, RAM reads and writes by address, and the ring of the last executed instructions,
+//     which is written as binary file, when the program fails
+struct NoProfile {
+   static const bool enabled = false;
+
+   void step(int, int) {}
+   void jump(int, bool) {}
+   void read(int) {}
+   void write(int) {}
+};
+
+//
+class Profiler {
+public:
+   static const bool enabled = true;
+   static const int traceSize = 1024; // power of 2
+
+   // the opcodes are 0..9, then the words over 999, the negative ones
+   static const int opcodeCount = 12;
+
+   // executed instruction, as it's in the binary trace
+   struct TraceEntry {
+      std::uint32_t _step;    // number of the instruction in the run, from 0
+      std::uint16_t _address;
+      std::uint16_t _reserved;
+      std::int32_t _word;
+   };
+
+   Profiler() { reset(); }
+
+   void reset(); // for the next case
+
+   void step(int address, int word) {
+      _execs[address]++;
+      _opcodes[word < 0 ? 11 : word > 999 ? 10 : word / 100]++;
+      TraceEntry& entry = _trace[_steps & (traceSize - 1)];
+      entry._step = static_cast<std::uint32_t>(_steps);
+      entry._address = static_cast<std::uint16_t>(address);
+      entry._reserved = 0;
+      entry._word = word;
+      _steps++;
+   }
+
+   void jump(int address, bool taken) {
+      (taken ? _taken : _notTaken)[address]++;
+   }
+
+   void read(int address) { _reads[address]++; }
+   void write(int address) { _writes[address]++; }
+
+   // text report: the counts by opcode, the table of the addresses with any count, RAM heatmap
+   void print(std::ostream& out) const;
+
+   // "GTRC", number of the entries (uint32), then TraceEntry of them, the oldest first
+   void writeTrace(std::ostream& out) const;
+
+private:
+   typedef std::array<std::uint64_t, 1000> Counts;
+
+   Counts _execs;
+   Counts _taken;
+   Counts _notTaken;
+   Counts _reads;
+   Counts _writes;
+   std::array<std::uint64_t, opcodeCount> _opcodes;
+   std::array<TraceEntry, traceSize> _trace;
+   std::uint64_t _steps;
+};
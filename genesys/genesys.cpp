@@ -1,154 +1,106 @@
 // genesys.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <strstream>
 #include <string>
-#include <array>
-
-using namespace std::string_literals;
-
-//
-class Interpreter {
-public:
-   Interpreter() { 
-      reset(); 
+#include <vector>
+
+#include "Batch.h"
+#include "InputReader.h"
+#include "Interpreter.h"
+
+// "genesys [switch|decoded|compiled] [batch] [threads=N] [profile] [trace=file]" - the engine,
+// compiled is the default. switch runs the original engine, it's the reference for the others.
+// batch reads all the cases first and runs them on N threads (all the hardware ones by default).
+// profile and trace run the decoded engine with Profiler, case by case: profile prints its report
+// of every case to stderr, trace appends the binary trace of the failed cases to the file
+int main(int argc, char* argv[]) {
+   Interpreter::Engine engine = Interpreter::engineCompiled;
+   bool batch = false;
+   unsigned threads = 0;
+   bool profile = false;
+   std::string tracePath;
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "batch")
+         batch = true;
+      else if (arg.compare(0, 8, "threads=") == 0)
+         threads = static_cast<unsigned>(std::stoul(arg.substr(8)));
+      else if (arg == "profile")
+         profile = true;
+      else if (arg.compare(0, 6, "trace=") == 0)
+         tracePath = arg.substr(6);
+      else if (!Interpreter::engineByName(arg, engine)) {
+         std::cout << "usage: genesys [switch|decoded|compiled] [batch] [threads=N] [profile] [trace=file] < input" << std::endl;
+         return 1;
+      }
    }
-
-   void reset(); // reset the interpreter
-
-   void setNextMemory(int num) {
-      _mem[_write++] = num;
+   bool profiling = profile || !tracePath.empty();
+   if (batch && profiling) {
+      std::cout << "profile and trace go without batch" << std::endl;
+      return 1;
    }
 
-   // run content in memory
-   int run();
-
-private:
-   void execute(int instr);
+   // read standard input
+   InputReader input;
+   if (!input.readAll(stdin)) {
+      std::cout << "can't read the input" << std::endl;
+      return 1;
+   }
 
-   std::array<int, 10> _regs; // registers
-   std::array<int, 1000> _mem; // registers
-   int _write; // position where next setNextMemory() will happen 
-   int _exec; // position of next executing instruction
-   bool _halt; // executed halt command
-};
+   // read number of cases
+   int cntCases = input.caseCount();
+   int count = 0;
+
+   if (batch) {
+      Batch cases;
+      std::vector<int> words(Interpreter::memSize);
+      for (int i = 0; i < cntCases; i++) {
+         if (!input.nextCase(words.data(), Interpreter::memSize, count)) {
+            std::cout << "case " << i << ": " << input.error() << std::endl;
+            return 1;
+         }
+         cases.addCase(words.data(), count);
+      }
+      cases.run(engine, threads);
+      cases.print(std::cout);
+      return 0;
+   }
 
-//
-int main() {
-   // read standard input and initialize interpreter
+   // each case goes right into the interpreter
    Interpreter mach;
-   
-   // read number of cases
-   int cntCases = 0;
-   std::cin >> cntCases;
+   Profiler prof;
+   std::ofstream trace;
    for (int i = 0; i < cntCases; i++) {
       mach.reset();
-      // read each case
-      std::string line;
-      std::getline(std::cin, line);
-      // there is a confusion in text descrption and example input
-      // lets tolerate for that
-      if((0 == i) && line.empty())
-         std::getline(std::cin, line);
-      while (!line.empty()) {
-         int instr = stoi(line);
-         mach.setNextMemory(instr);
-         std::getline(std::cin, line);
+      if (!input.nextCase(mach.memory(), Interpreter::memSize, count)) {
+         std::cout << "case " << i << ": " << input.error() << std::endl;
+         return 1;
       }
-      int res = mach.run(); // for now
-      std::cout << res << std::endl;
-   }
-   return 0;
-}
-
-//
-void Interpreter::reset() { // reset the interpreter
-   for (int& cur : _regs)
-      cur = 0;
-   for (int& cur : _mem)
-      cur = 0;
-   _write = 0;
-   _exec = 0;
-   _halt = false;
-}
-
-//
-int Interpreter::run() { // reset the interpreter
-   int qntInstr = 0;
-   while (!_halt && (_exec < _write)) { // let be safe still
-      int instr = _mem[_exec++];
-      try {
-         execute(instr);
+      mach.loaded(count);
+      int res = 0;
+      if (profiling) {
+         prof.reset();
+         res = mach.runProfiled(prof);
       }
-      catch (std::string err) {
-         std::cout << "error: '" << err << "' executing: " << instr << " at address: " << _exec - 1 << std::endl;
-         _halt = true;
+      else
+         res = mach.run(engine);
+      if (mach.status() != Interpreter::statusOk) {
+         std::cout << mach.errorText() << '\n';
+         if (!tracePath.empty()) {
+            if (!trace.is_open())
+               trace.open(tracePath, std::ios::binary | std::ios::app);
+            prof.writeTrace(trace);
+         }
+      }
+      std::cout << res << '\n';
+      if (profile) {
+         std::cerr << "case " << i << ":\n";
+         prof.print(std::cerr);
       }
-      qntInstr++;
-   }
-   return qntInstr;
-}
-
-//
-void Interpreter::execute(int instr) {
-   // parse instruction
-   int p2 = instr % 10;
-   instr /= 10;
-   int p1 = instr % 10;
-   int icod = instr / 10;
-
-   // for now we just go straight with switch. 
-   // however much cleaner and probably faster would be with array of member function
-   int tmp = 0;
-   switch (icod) {
-   case 1: // 100 means halt
-      // both params should be 0 // or we shell ignore their values
-      if (p2 || p1)
-         throw "invalid instruction"s; // ??? 
-      _halt = true;
-      break;
-
-   case 2: // 2dn means set register d to n (between 0 and 9)
-      _regs[p1] = p2;
-      break;
-
-   case 3: // 3dn means add n to register d
-      tmp = _regs[p1] + p2;
-      _regs[p1] = tmp % 1000;
-      break;
-
-   case 4: // 4dn means multiply register d by n
-      tmp = _regs[p1] * p2;
-      _regs[p1] = tmp % 1000;
-      break;
-
-   case 5: // 5ds means set register d to the value of register s
-      _regs[p1] = _regs[p2];
-      break;
-
-   case 6: // 6ds means add the value of register s to register d
-      tmp = _regs[p1] + _regs[p2];
-      _regs[p1] = tmp % 1000;
-      break;
-
-   case 7: // 7ds means multiply register d by the value of register s
-      tmp = _regs[p1] * _regs[p2];
-      _regs[p1] = tmp % 1000;
-      break;
-
-   case 8: // 8da means set register d to the value in RAM whose address is in register a
-      _regs[p1] = _mem[_regs[p2]];
-      break;
-
-   case 9: // 9sa means set the value in RAM whose address is in register a to the value of register s
-      _mem[_regs[p2]] = _regs[p1];
-      break;
-
-   case 0: // 0ds means goto the location in register d unless register s contains 0
-      if (_regs[p2])
-         _exec = _regs[p1];
-      break;
-
    }
+   std::cout.flush();
+   return 0;
 }
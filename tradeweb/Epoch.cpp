@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "Epoch.h"
+
+// announced epoch of a thread, the records are never freed - they're reused by the new threads
+struct alignas(64) EpochRecord {
+   std::atomic<std::uint64_t> _epoch{0}; // 0 - outside of the Guard
+   std::atomic<bool> _used{false};
+   unsigned _depth = 0; // nested guards, touched by the owner thread only
+   EpochRecord* _next = nullptr;
+};
+
+namespace {
+
+std::atomic<std::uint64_t> g_epoch{1};
+std::atomic<EpochRecord*> g_records{nullptr};
+
+// retired memory, waiting for the readers
+struct Retired {
+   void* _p;
+   void (*_deleter)(void*);
+   std::uint64_t _epoch;
+};
+
+struct Limbo {
+   std::mutex _lock;
+   std::vector<Retired> _items;
+
+   // no readers are left at exit
+   ~Limbo() {
+      for (Retired& r : _items)
+         r._deleter(r._p);
+   }
+};
+
+Limbo g_limbo;
+
+// free record from the list or the new one
+EpochRecord* acquireRecord() {
+   for (EpochRecord* rec = g_records.load(std::memory_order_acquire); rec; rec = rec->_next) {
+      bool expected = false;
+      if (!rec->_used.load(std::memory_order_relaxed) &&
+          rec->_used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+         return rec;
+   }
+   EpochRecord* rec = new EpochRecord;
+   rec->_used.store(true, std::memory_order_relaxed);
+   EpochRecord* head = g_records.load(std::memory_order_relaxed);
+   do
+      rec->_next = head;
+   while (!g_records.compare_exchange_weak(head, rec, std::memory_order_release, std::memory_order_relaxed));
+   return rec;
+}
+
+// record of the thread, it's returned to the list on the thread exit
+struct ThreadRecord {
+   EpochRecord* _rec = nullptr;
+
+   ~ThreadRecord() {
+      if (_rec)
+         _rec->_used.store(false, std::memory_order_release);
+   }
+
+   EpochRecord& get() {
+      if (!_rec)
+         _rec = acquireRecord();
+      return *_rec;
+   }
+};
+
+thread_local ThreadRecord t_record;
+
+// the oldest epoch announced by the readers inside the Guard
+std::uint64_t oldestActive() {
+   std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+   for (EpochRecord* rec = g_records.load(std::memory_order_acquire); rec; rec = rec->_next) {
+      std::uint64_t epoch = rec->_epoch.load(std::memory_order_seq_cst);
+      if (epoch)
+         oldest = std::min(oldest, epoch);
+   }
+   return oldest;
+}
+
+} // namespace
+
+// seq_cst announcement - the writer, which retires the memory after the reader has loaded
+// the pointer to it, sees the announced epoch
+Epoch::Guard::Guard() : m_rec(&t_record.get()) {
+   if (0 == m_rec->_depth++)
+      m_rec->_epoch.store(g_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+//
+Epoch::Guard::~Guard() {
+   if (0 == --m_rec->_depth)
+      m_rec->_epoch.store(0, std::memory_order_release);
+}
+
+// memory retired at epoch E is freed, when all the active readers announced epoch > E
+void Epoch::retire(void* p, void (*deleter)(void*)) {
+   std::vector<Retired> ready;
+   {
+      std::lock_guard<std::mutex> guard(g_limbo._lock);
+      g_limbo._items.push_back({p, deleter, g_epoch.fetch_add(1, std::memory_order_seq_cst)});
+      std::uint64_t oldest = oldestActive();
+      auto keep = std::partition(g_limbo._items.begin(), g_limbo._items.end(),
+                                 [oldest](const Retired& r) { return r._epoch >= oldest; });
+      ready.assign(keep, g_limbo._items.end());
+      g_limbo._items.erase(keep, g_limbo._items.end());
+   }
+   for (Retired& r : ready)
+      r._deleter(r._p);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+struct EpochRecord;
+
+// Epoch based reclamation of the memory, which is read by the lock-free readers:
+//   - reader wraps the access into Epoch::Guard, which announces the global epoch in
+//     the record of its thread - readers never write a shared cache line;
+//   - writer unlinks the memory, retires it with the current epoch and advances the epoch;
+//   - retired memory is freed, once every thread inside a Guard has announced a later epoch.
+// Guards may be nested. Retired memory is collected by the later retire() calls
+class Epoch {
+public:
+   class Guard {
+   public:
+      Guard();
+      ~Guard();
+
+      Guard(const Guard&) = delete;
+      Guard& operator=(const Guard&) = delete;
+
+   private:
+      EpochRecord* m_rec;
+   };
+
+   // p is passed to deleter, once no reader can see it
+   static void retire(void* p, void (*deleter)(void*));
+
+   template <class T>
+   static void retire(T* p) {
+      retire(p, [](void* q) { delete static_cast<T*>(q); });
+   }
+};
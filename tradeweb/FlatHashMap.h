@@ -0,0 +1,399 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLATHASH_SSE2 1
+#endif
+
+// Open addressing hash map with SIMD probed control bytes (the "swiss table" layout):
+//   - every slot has 1 control byte: empty, deleted or 7 low bits of the hash of its key;
+//   - the control bytes are scanned by groups of 16 with single SSE2 compare,
+//     only the slots with matching 7 bits are compared by the key;
+//   - keys and values live inline in one array, there are no nodes and no pointer chasing;
+//   - max load is 7/8, deleted slots are reused, the table is rebuilt when they pile up.
+// Differences from std::unordered_map:
+//   - insert/erase/rehash invalidate iterators and references, elements are moved on rehash;
+//   - value_type is std::pair<K, V>, the key must not be modified through the iterator.
+// find()/erase() are heterogeneous, if Hash and Eq accept the argument (is_transparent ones)
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>,
+          class Alloc = std::allocator<std::pair<K, V>>>
+class FlatHashMap {
+public:
+   using key_type = K;
+   using mapped_type = V;
+   using value_type = std::pair<K, V>;
+   using size_type = std::size_t;
+   using allocator_type = Alloc;
+
+private:
+   using Ctrl = std::int8_t;
+
+   static constexpr Ctrl ctrlEmpty = -128;   // 0b10000000
+   static constexpr Ctrl ctrlDeleted = -2;   // 0b11111110
+   static constexpr size_type groupWidth = 16;
+
+   // mask of matched positions in the group of 16 control bytes
+   class Group {
+   public:
+      explicit Group(const Ctrl* p) {
+#ifdef FLATHASH_SSE2
+         m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+#else
+         std::memcpy(m_ctrl, p, groupWidth);
+#endif
+      }
+
+      std::uint32_t match(Ctrl h2) const {
+#ifdef FLATHASH_SSE2
+         return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+#else
+         std::uint32_t mask = 0;
+         for (size_type i = 0; i < groupWidth; i++)
+            mask |= std::uint32_t(m_ctrl[i] == h2) << i;
+         return mask;
+#endif
+      }
+
+      std::uint32_t matchEmpty() const { return match(ctrlEmpty); }
+
+      // both empty and deleted have the high bit set, full slots don't
+      std::uint32_t matchFree() const {
+#ifdef FLATHASH_SSE2
+         return static_cast<std::uint32_t>(_mm_movemask_epi8(m_ctrl));
+#else
+         std::uint32_t mask = 0;
+         for (size_type i = 0; i < groupWidth; i++)
+            mask |= std::uint32_t(m_ctrl[i] < 0) << i;
+         return mask;
+#endif
+      }
+
+   private:
+#ifdef FLATHASH_SSE2
+      __m128i m_ctrl;
+#else
+      Ctrl m_ctrl[groupWidth];
+#endif
+   };
+
+   using SlotAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<value_type>;
+   using CtrlAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Ctrl>;
+   using SlotTraits = std::allocator_traits<SlotAlloc>;
+
+   template <bool Const>
+   class Iter {
+   public:
+      using value_type = FlatHashMap::value_type;
+      using reference = std::conditional_t<Const, const value_type&, value_type&>;
+      using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+      using difference_type = std::ptrdiff_t;
+      using iterator_category = std::forward_iterator_tag;
+
+      Iter() = default;
+
+      template <bool C = Const, class = std::enable_if_t<C>>
+      Iter(const Iter<false>& other) : m_ctrl(other.m_ctrl), m_slot(other.m_slot), m_end(other.m_end) {}
+
+      reference operator*() const { return *m_slot; }
+      pointer operator->() const { return m_slot; }
+
+      Iter& operator++() {
+         ++m_ctrl;
+         ++m_slot;
+         skipFree();
+         return *this;
+      }
+
+      Iter operator++(int) {
+         Iter tmp = *this;
+         ++*this;
+         return tmp;
+      }
+
+      bool operator==(const Iter& other) const { return m_ctrl == other.m_ctrl; }
+
+   private:
+      friend class FlatHashMap;
+      template <bool> friend class Iter;
+
+      Iter(const Ctrl* ctrl, pointer slot, const Ctrl* end) : m_ctrl(ctrl), m_slot(slot), m_end(end) {}
+
+      void skipFree() {
+         while (m_ctrl != m_end && *m_ctrl < 0) {
+            ++m_ctrl;
+            ++m_slot;
+         }
+      }
+
+      const Ctrl* m_ctrl = nullptr;
+      pointer m_slot = nullptr;
+      const Ctrl* m_end = nullptr;
+   };
+
+public:
+   using iterator = Iter<false>;
+   using const_iterator = Iter<true>;
+
+   explicit FlatHashMap(const Alloc& alloc = Alloc()) : m_alloc(alloc) {}
+
+   FlatHashMap(const FlatHashMap&) = delete;
+   FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+   FlatHashMap(FlatHashMap&& other) noexcept
+      : m_alloc(other.m_alloc), m_ctrl(other.m_ctrl), m_slots(other.m_slots), m_capacity(other.m_capacity),
+        m_size(other.m_size), m_growthLeft(other.m_growthLeft), m_rehashes(other.m_rehashes) {
+      other.forget();
+   }
+
+   FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+      if (this != &other) {
+         destroy();
+         m_alloc = other.m_alloc;
+         m_ctrl = other.m_ctrl;
+         m_slots = other.m_slots;
+         m_capacity = other.m_capacity;
+         m_size = other.m_size;
+         m_growthLeft = other.m_growthLeft;
+         m_rehashes = other.m_rehashes;
+         other.forget();
+      }
+      return *this;
+   }
+
+   ~FlatHashMap() { destroy(); }
+
+   iterator begin() { return makeIter<false>(0); }
+   iterator end() { return makeIter<false>(m_capacity); }
+   const_iterator begin() const { return makeIter<true>(0); }
+   const_iterator end() const { return makeIter<true>(m_capacity); }
+
+   size_type size() const { return m_size; }
+   bool empty() const { return !m_size; }
+   size_type capacity() const { return m_capacity; }
+   size_type bucket_count() const { return m_capacity; }
+   double load_factor() const { return m_capacity ? double(m_size) / double(m_capacity) : 0.0; }
+
+   // number of times the table was rebuilt - for the statistics
+   size_type rehashes() const { return m_rehashes; }
+
+   template <class K2>
+   iterator find(const K2& key) {
+      size_type idx = findIndex(key, hashOf(key));
+      return npos == idx ? end() : makeIter<false>(idx);
+   }
+
+   template <class K2>
+   const_iterator find(const K2& key) const {
+      size_type idx = findIndex(key, hashOf(key));
+      return npos == idx ? end() : makeIter<true>(idx);
+   }
+
+   template <class K2>
+   bool contains(const K2& key) const { return npos != findIndex(key, hashOf(key)); }
+
+   // key is any type, K can be constructed from (std::string from std::string_view)
+   template <class K2, class... Args>
+   std::pair<iterator, bool> try_emplace(K2&& key, Args&&... args) {
+      size_type hash = hashOf(key);
+      size_type idx = findIndex(key, hash);
+      if (npos != idx)
+         return {makeIter<false>(idx), false};
+      idx = prepareInsert(hash);
+      SlotTraits::construct(m_alloc, m_slots + idx, std::piecewise_construct,
+                            std::forward_as_tuple(std::forward<K2>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+      m_size++;
+      return {makeIter<false>(idx), true};
+   }
+
+   template <class K2, class V2>
+   std::pair<iterator, bool> emplace(K2&& key, V2&& value) {
+      return try_emplace(std::forward<K2>(key), std::forward<V2>(value));
+   }
+
+   V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+   void erase(const_iterator it) { eraseIndex(static_cast<size_type>(it.m_ctrl - m_ctrl)); }
+   void erase(iterator it) { eraseIndex(static_cast<size_type>(it.m_ctrl - m_ctrl)); }
+
+   template <class K2>
+   size_type erase(const K2& key) {
+      size_type idx = findIndex(key, hashOf(key));
+      if (npos == idx)
+         return 0;
+      eraseIndex(idx);
+      return 1;
+   }
+
+   void clear() {
+      destroySlots();
+      if (m_capacity)
+         std::memset(m_ctrl, ctrlEmpty, m_capacity);
+      m_size = 0;
+      m_growthLeft = maxLoad(m_capacity);
+   }
+
+   void reserve(size_type count) {
+      if (count > m_size + m_growthLeft)
+         rehash(capacityFor(count));
+   }
+
+private:
+   static constexpr size_type npos = ~size_type(0);
+
+   // std::hash of integers is identity for some STLs - spread it over all bits
+   template <class K2>
+   size_type hashOf(const K2& key) const {
+      std::uint64_t h = static_cast<std::uint64_t>(Hash{}(key));
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      return static_cast<size_type>(h);
+   }
+
+   static Ctrl h2(size_type hash) { return static_cast<Ctrl>(hash & 0x7f); }
+
+   static size_type maxLoad(size_type capacity) { return capacity - capacity / 8; }
+
+   static size_type capacityFor(size_type count) {
+      size_type cap = groupWidth;
+      while (maxLoad(cap) < count)
+         cap *= 2;
+      return cap;
+   }
+
+   template <bool Const>
+   Iter<Const> makeIter(size_type idx) const {
+      Iter<Const> it(m_ctrl + idx, m_slots + idx, m_ctrl + m_capacity);
+      it.skipFree();
+      return it;
+   }
+
+   template <class K2>
+   size_type findIndex(const K2& key, size_type hash) const {
+      if (!m_capacity)
+         return npos;
+      size_type groupMask = m_capacity / groupWidth - 1;
+      size_type group = (hash >> 7) & groupMask;
+      for (size_type step = 1;; step++) {
+         const size_type base = group * groupWidth;
+         Group g(m_ctrl + base);
+         for (std::uint32_t mask = g.match(h2(hash)); mask; mask &= mask - 1) {
+            size_type idx = base + std::countr_zero(mask);
+            if (Eq{}(m_slots[idx].first, key))
+               return idx;
+         }
+         if (g.matchEmpty())
+            return npos;
+         group = (group + step) & groupMask; // triangular probing visits every group
+      }
+   }
+
+   // first free slot of the probe sequence, there has to be one
+   size_type findFree(size_type hash) const {
+      size_type groupMask = m_capacity / groupWidth - 1;
+      size_type group = (hash >> 7) & groupMask;
+      for (size_type step = 1;; step++) {
+         const size_type base = group * groupWidth;
+         std::uint32_t mask = Group(m_ctrl + base).matchFree();
+         if (mask)
+            return base + std::countr_zero(mask);
+         group = (group + step) & groupMask;
+      }
+   }
+
+   // returns slot for the new key and marks it used
+   size_type prepareInsert(size_type hash) {
+      size_type idx = m_capacity ? findFree(hash) : npos;
+      if (npos == idx || (!m_growthLeft && ctrlEmpty == m_ctrl[idx])) {
+         // lots of deleted slots - rebuild at the same size, otherwise grow
+         rehash(m_size + 1 <= maxLoad(m_capacity) / 2 ? m_capacity : capacityFor(m_size + 1));
+         idx = findFree(hash);
+      }
+      if (ctrlEmpty == m_ctrl[idx])
+         m_growthLeft--;
+      m_ctrl[idx] = h2(hash);
+      return idx;
+   }
+
+   void eraseIndex(size_type idx) {
+      SlotTraits::destroy(m_alloc, m_slots + idx);
+      m_size--;
+      // probe sequences never pass the group with an empty slot, so the slot may become empty again
+      if (Group(m_ctrl + idx / groupWidth * groupWidth).matchEmpty()) {
+         m_ctrl[idx] = ctrlEmpty;
+         m_growthLeft++;
+      }
+      else
+         m_ctrl[idx] = ctrlDeleted;
+   }
+
+   void rehash(size_type capacity) {
+      CtrlAlloc ctrlAlloc(m_alloc);
+      Ctrl* oldCtrl = m_ctrl;
+      value_type* oldSlots = m_slots;
+      size_type oldCapacity = m_capacity;
+      m_ctrl = std::allocator_traits<CtrlAlloc>::allocate(ctrlAlloc, capacity);
+      m_slots = SlotTraits::allocate(m_alloc, capacity);
+      std::memset(m_ctrl, ctrlEmpty, capacity);
+      m_capacity = capacity;
+      m_growthLeft = maxLoad(capacity) - m_size;
+      for (size_type i = 0; i < oldCapacity; i++) {
+         if (oldCtrl[i] < 0)
+            continue;
+         size_type hash = hashOf(oldSlots[i].first);
+         size_type idx = findFree(hash);
+         m_ctrl[idx] = h2(hash);
+         SlotTraits::construct(m_alloc, m_slots + idx, std::move(oldSlots[i]));
+         SlotTraits::destroy(m_alloc, oldSlots + i);
+      }
+      if (oldCapacity) {
+         std::allocator_traits<CtrlAlloc>::deallocate(ctrlAlloc, oldCtrl, oldCapacity);
+         SlotTraits::deallocate(m_alloc, oldSlots, oldCapacity);
+      }
+      m_rehashes++;
+   }
+
+   void destroySlots() {
+      if constexpr (!std::is_trivially_destructible_v<value_type>) {
+         for (size_type i = 0; i < m_capacity; i++) {
+            if (m_ctrl[i] >= 0)
+               SlotTraits::destroy(m_alloc, m_slots + i);
+         }
+      }
+   }
+
+   void destroy() {
+      if (!m_capacity)
+         return;
+      destroySlots();
+      CtrlAlloc ctrlAlloc(m_alloc);
+      std::allocator_traits<CtrlAlloc>::deallocate(ctrlAlloc, m_ctrl, m_capacity);
+      SlotTraits::deallocate(m_alloc, m_slots, m_capacity);
+      forget();
+   }
+
+   void forget() {
+      m_ctrl = nullptr;
+      m_slots = nullptr;
+      m_capacity = 0;
+      m_size = 0;
+      m_growthLeft = 0;
+   }
+
+   SlotAlloc m_alloc;
+   Ctrl* m_ctrl = nullptr;
+   value_type* m_slots = nullptr;
+   size_type m_capacity = 0;  // 0 or power of 2 >= groupWidth
+   size_type m_size = 0;
+   size_type m_growthLeft = 0; // empty slots, which may be taken before the rehash
+   size_type m_rehashes = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "NodePool.h"
+#include "FlatHashMap.h"
+
+// Hash map used by the cache indexes, selected at compile time:
+//   - default - FlatHashMap, open addressing with SIMD probing;
+//   - ORDERCACHE_STD_HASH - std::unordered_map with the nodes from NodePool,
+//     kept to compare against (see OrderCacheBench.cpp).
+// Both are constructed from NodePool*, the flat one doesn't have nodes and takes its arrays from the heap
+#ifdef ORDERCACHE_STD_HASH
+
+static constexpr const char* hashMapName = "std::unordered_map";
+
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+using HashMap = std::unordered_map<K, V, Hash, Eq, PoolAllocator<std::pair<const K, V>>>;
+
+#else
+
+static constexpr const char* hashMapName = "FlatHashMap";
+
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+using HashMap = FlatHashMap<K, V, Hash, Eq, PoolAllocator<std::pair<K, V>>>;
+
+#endif
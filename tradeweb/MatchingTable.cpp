@@ -0,0 +1,60 @@
+#include "MatchingTable.h"
+#include "SymbolTable.h"
+#include "Epoch.h"
+
+static const std::size_t initialSlots = 64;
+
+//
+MatchingTable::Table::Table(std::size_t capacity)
+   : _mask(capacity - 1), _slots(new std::atomic<const Entry*>[capacity]) {
+   for (std::size_t i = 0; i < capacity; i++)
+      _slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+//
+MatchingTable::MatchingTable() : m_table(new Table(initialSlots)) {}
+
+// there are no readers left
+MatchingTable::~MatchingTable() {
+   delete m_table.load(std::memory_order_relaxed);
+}
+
+// release - the reader, which finds the entry, sees it constructed
+void MatchingTable::insert(Table& table, const Entry* entry) {
+   std::size_t pos = entry->_hash & table._mask;
+   while (table._slots[pos].load(std::memory_order_relaxed))
+      pos = (pos + 1) & table._mask;
+   table._slots[pos].store(entry, std::memory_order_release);
+}
+
+//
+MatchingTable::Id MatchingTable::add(std::string_view name) {
+   Id id = static_cast<Id>(m_entries.size());
+   const Entry& entry = m_entries.emplace_back(name, StrHash{}(name));
+   Table* table = m_table.load(std::memory_order_relaxed);
+   if (2 * m_entries.size() <= table->_mask + 1) {
+      insert(*table, &entry);
+      return id;
+   }
+   // the readers go on with the old table until the new one is published
+   Table* bigger = new Table(2 * (table->_mask + 1));
+   for (const Entry& e : m_entries)
+      insert(*bigger, &e);
+   m_table.store(bigger, std::memory_order_seq_cst);
+   Epoch::retire(table);
+   return id;
+}
+
+//
+unsigned MatchingTable::load(std::string_view name) const {
+   std::size_t hash = StrHash{}(name);
+   Epoch::Guard guard;
+   const Table* table = m_table.load(std::memory_order_seq_cst);
+   for (std::size_t pos = hash & table->_mask;; pos = (pos + 1) & table->_mask) {
+      const Entry* entry = table->_slots[pos].load(std::memory_order_acquire);
+      if (!entry)
+         return 0; // no such security
+      if (entry->_hash == hash && entry->_name == name)
+         return entry->_matching.load(std::memory_order_acquire);
+   }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Security name -> published matching size, read without any lock:
+//   - the writer (serialized by the owner) adds the securities and stores their sizes;
+//   - the entries are never removed and never move, the slot array is insert-only,
+//     on growth it's replaced by the bigger copy and the old one is freed through Epoch;
+//   - load() is wait-free: epoch announcement, bounded probing, atomic load of the size
+class MatchingTable {
+public:
+   using Id = std::uint32_t;
+
+   MatchingTable();
+   ~MatchingTable();
+
+   MatchingTable(const MatchingTable&) = delete;
+   MatchingTable& operator=(const MatchingTable&) = delete;
+
+   // writer - the new security, its id is the number of the securities before
+   Id add(std::string_view name);
+
+   // writer
+   void store(Id sec, unsigned matching) { m_entries[sec]._matching.store(matching, std::memory_order_release); }
+
+   // reader, 0 - no such security
+   unsigned load(std::string_view name) const;
+
+private:
+   struct Entry {
+      Entry(std::string_view name, std::size_t hash) : _name(name), _hash(hash) {}
+
+      std::string _name;
+      std::size_t _hash;
+      std::atomic<unsigned> _matching{0};
+   };
+
+   // open addressing with linear probing, at most half full
+   struct Table {
+      explicit Table(std::size_t capacity);
+
+      std::size_t _mask;
+      std::unique_ptr<std::atomic<const Entry*>[]> _slots;
+   };
+
+   static void insert(Table& table, const Entry* entry);
+
+   std::deque<Entry> m_entries;  // indexed by the security id, written by the writer only
+   std::atomic<Table*> m_table;
+};
@@ -0,0 +1,45 @@
+#include <new>
+
+#include "NodePool.h"
+
+//
+NodePool::~NodePool() {
+   for (void* slab : m_slabs)
+      ::operator delete(slab);
+}
+
+//
+void* NodePool::allocate(std::size_t size) {
+   if (size > maxNode)
+      return ::operator new(size);
+   std::size_t cls = sizeClass(size);
+   FreeNode* node = m_free[cls];
+   if (node) {
+      m_free[cls] = node->_next;
+      return node;
+   }
+   std::size_t bytes = (cls + 1) * granularity;
+   if (m_left < bytes) {
+      // the tail of the previous slab is lost, it's less than maxNode
+      m_slabs.reserve(m_slabs.size() + 1);
+      m_cur = static_cast<char*>(::operator new(slabSize));
+      m_slabs.push_back(m_cur);
+      m_left = slabSize;
+   }
+   void* p = m_cur;
+   m_cur += bytes;
+   m_left -= bytes;
+   return p;
+}
+
+//
+void NodePool::deallocate(void* p, std::size_t size) noexcept {
+   if (size > maxNode) {
+      ::operator delete(p);
+      return;
+   }
+   std::size_t cls = sizeClass(size);
+   FreeNode* node = static_cast<FreeNode*>(p);
+   node->_next = m_free[cls];
+   m_free[cls] = node;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+// Slab allocator for the small fixed size nodes of the node based containers:
+//   - memory is carved from 64K slabs, freed nodes go to the free list of their size class
+//     and are recycled by the next allocation of the same size
+//   - slabs are returned only when the pool dies, so add/cancel churn doesn't touch malloc
+//     and doesn't fragment the heap
+//   - bigger blocks (bucket arrays) go to the regular heap
+//   - not thread safe, the owner protects it
+class NodePool {
+public:
+   NodePool() = default;
+   NodePool(const NodePool&) = delete;
+   NodePool& operator=(const NodePool&) = delete;
+   ~NodePool();
+
+   static constexpr std::size_t granularity = 16;
+   static constexpr std::size_t maxNode = 128;
+
+   void* allocate(std::size_t size);
+   void deallocate(void* p, std::size_t size) noexcept;
+
+   // memory taken from the heap for the slabs
+   std::size_t slabBytes() const { return m_slabs.size() * slabSize; }
+
+private:
+   static constexpr std::size_t slabSize = 64 * 1024;
+   static constexpr std::size_t classes = maxNode / granularity;
+
+   static std::size_t sizeClass(std::size_t size) { return (size + granularity - 1) / granularity - 1; }
+
+   struct FreeNode {
+      FreeNode* _next;
+   };
+
+   std::array<FreeNode*, classes> m_free{};
+   std::vector<void*> m_slabs;
+   char* m_cur = nullptr;  // not used part of the last slab
+   std::size_t m_left = 0;
+};
+
+// std allocator on top of NodePool, single node allocations go to the pool.
+// Default constructed one (no pool) works as std::allocator
+template <class T>
+class PoolAllocator {
+public:
+   using value_type = T;
+   using propagate_on_container_copy_assignment = std::true_type;
+   using propagate_on_container_move_assignment = std::true_type;
+   using propagate_on_container_swap = std::true_type;
+
+   PoolAllocator(NodePool* pool = nullptr) noexcept : m_pool(pool) {}
+
+   template <class U>
+   PoolAllocator(const PoolAllocator<U>& other) noexcept : m_pool(other.pool()) {}
+
+   T* allocate(std::size_t n) {
+      if (pooled(n))
+         return static_cast<T*>(m_pool->allocate(sizeof(T)));
+      return std::allocator<T>{}.allocate(n);
+   }
+
+   void deallocate(T* p, std::size_t n) noexcept {
+      if (pooled(n))
+         m_pool->deallocate(p, sizeof(T));
+      else
+         std::allocator<T>{}.deallocate(p, n);
+   }
+
+   NodePool* pool() const noexcept { return m_pool; }
+
+   template <class U>
+   bool operator==(const PoolAllocator<U>& other) const noexcept { return m_pool == other.pool(); }
+
+private:
+   bool pooled(std::size_t n) const noexcept {
+      return m_pool && (1 == n) && (sizeof(T) <= NodePool::maxNode) && (alignof(T) <= NodePool::granularity);
+   }
+
+   NodePool* m_pool;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Order
@@ -20,6 +21,13 @@ class Order
   std::string user() const       { return m_user; }
   std::string company() const    { return m_company; }
   unsigned int qty() const       { return m_qty; }
+
+  // zero-copy accessors for the cache internals, valid while the order is alive
+  std::string_view orderIdView() const noexcept    { return m_orderId; }
+  std::string_view securityIdView() const noexcept { return m_securityId; }
+  std::string_view sideView() const noexcept       { return m_side; }
+  std::string_view userView() const noexcept       { return m_user; }
+  std::string_view companyView() const noexcept    { return m_company; }
   
  private:
   
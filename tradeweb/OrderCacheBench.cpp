@@ -0,0 +1,316 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <latch>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+
+#include "OrderCacheBench.h"
+#include "OrderCacheWorkload.h"
+#include "OrderCacheImpl.h"
+#include "ShardedOrderCacheImpl.h"
+#include "FlatHashMap.h"
+
+using std::cout; using std::cerr; using std::endl;
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// operations of OrderCacheInterface, the workload is a mix of them
+enum OpKind : unsigned { opAdd, opCancel, opCancelUser, opCancelSec, opMatch, opGetAll, opKinds };
+
+const char* const opNames[opKinds] = {"addOrder", "cancelOrder", "cancelOrdersForUser",
+                                      "cancelOrdersForSecIdWithMinimumQty", "getMatchingSizeForSecurity", "getAllOrders"};
+
+// benchmark settings, "tradeweb bench key=value ...", see usage()
+struct Config : WorkloadConfig {
+   Config() : WorkloadConfig(1000000, 1000, 5000, 100, 10000, {50, 30, 1, 1, 18, 0}) {}
+
+   std::size_t _prefill = 100000;        // orders added before the timing
+   vector<unsigned> _threads{1};         // every count is a separate run
+   bool _json = false;                   // JSON lines instead of tab separated text
+   bool _hash = false;                   // hash table micro benchmarks first
+};
+
+//
+void usage() {
+   cerr << "usage: tradeweb bench [key=value ...]\n"
+           "  prefill=N       orders added before the timing (100000)\n"
+           "  threads=1,4,..  thread counts, one run for each (1)\n"
+           "  format=text|json  output (text)\n"
+           "  hash=1          run the hash table micro benchmarks too\n";
+   workloadUsage(cerr, Config(), "timed operations per thread", "add,cancel,cancelUser,cancelSec,match,getAll");
+}
+
+// false - unknown or malformed argument
+bool parseArgs(int argc, char* argv[], Config& cfg) {
+   auto benchArg = [&cfg](const string& key, const string& value) {
+      if (key.empty()) cfg._ops = std::stoul(value); // "tradeweb bench N" as before
+      else if ("prefill" == key) cfg._prefill = std::stoul(value);
+      else if ("threads" == key) cfg._threads = parseList(value);
+      else if ("format" == key && ("text" == value || "json" == value)) cfg._json = ("json" == value);
+      else if ("hash" == key) cfg._hash = ("0" != value);
+      else
+         return false;
+      return true;
+   };
+   if (!parseWorkloadArgs(argc, argv, cfg, benchArg))
+      return false;
+   for (unsigned t : cfg._threads) {
+      if (!t)
+         return false;
+   }
+   return !cfg._threads.empty();
+}
+
+// one line per result, either text or JSON, so the runs of two builds can be diffed
+class Reporter {
+public:
+   explicit Reporter(bool json) : m_json(json) {}
+
+   // mean time only - the hash table loops are timed as a whole
+   void mean(const char* suite, const char* table, const char* op, std::size_t n, double ns) const {
+      if (m_json)
+         cout << "{\"suite\":\"" << suite << "\",\"table\":\"" << table << "\",\"op\":\"" << op << "\",\"n\":" << n
+              << ",\"mean_ns\":" << ns << "}" << endl;
+      else
+         cout << suite << "\t" << table << "\t" << op << "\tn=" << n << "\t" << ns << " ns/op" << endl;
+   }
+
+   // latency percentiles of the single operation, samples get sorted
+   void latency(const char* suite, const string& table, const char* op, unsigned threads, vector<uint32_t>& ns,
+                double seconds) const {
+      if (ns.empty())
+         return;
+      std::sort(ns.begin(), ns.end());
+      double sum = 0;
+      for (uint32_t v : ns)
+         sum += v;
+      auto pct = [&ns](double p) { return ns[std::min(ns.size() - 1, static_cast<std::size_t>(p * ns.size()))]; };
+      double opsPerSec = ns.size() / seconds;
+      if (m_json)
+         cout << "{\"suite\":\"" << suite << "\",\"table\":\"" << table << "\",\"op\":\"" << op << "\",\"threads\":" << threads
+              << ",\"n\":" << ns.size() << ",\"ops_per_sec\":" << opsPerSec << ",\"mean_ns\":" << sum / ns.size()
+              << ",\"p50_ns\":" << pct(0.5) << ",\"p90_ns\":" << pct(0.9) << ",\"p99_ns\":" << pct(0.99)
+              << ",\"p999_ns\":" << pct(0.999) << ",\"max_ns\":" << ns.back() << "}" << endl;
+      else
+         cout << suite << "\t" << table << "\t" << op << "\tthreads=" << threads << "\tn=" << ns.size() << "\t" << opsPerSec
+              << " ops/s\tmean=" << sum / ns.size() << "\tp50=" << pct(0.5) << "\tp90=" << pct(0.9) << "\tp99=" << pct(0.99)
+              << "\tp99.9=" << pct(0.999) << "\tmax=" << ns.back() << " ns" << endl;
+   }
+
+private:
+   bool m_json;
+};
+
+//
+double nsPerOp(Clock::time_point start, std::size_t ops) {
+   return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(ops ? ops : 1);
+}
+
+// insert / find hit / find miss / erase over the same keys for any map
+template <class Map, class Key>
+void benchMap(const Reporter& out, const char* suite, const char* table, const vector<Key>& keys, const vector<Key>& misses) {
+   Map map;
+   std::size_t n = keys.size();
+   auto start = Clock::now();
+   for (std::size_t i = 0; i < n; i++)
+      map.try_emplace(keys[i], static_cast<unsigned>(i));
+   out.mean(suite, table, "insert", n, nsPerOp(start, n));
+   unsigned sum = 0;
+   start = Clock::now();
+   for (auto& k : keys)
+      sum += map.find(k)->second;
+   out.mean(suite, table, "find_hit", n, nsPerOp(start, n));
+   start = Clock::now();
+   for (auto& k : misses)
+      sum += (map.end() == map.find(k));
+   out.mean(suite, table, "find_miss", n, nsPerOp(start, n));
+   start = Clock::now();
+   for (auto& k : keys)
+      map.erase(k);
+   out.mean(suite, table, "erase", n, nsPerOp(start, n));
+   querySink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+// FlatHashMap against std::unordered_map, integer and string keys
+void benchHashTables(const Reporter& out, std::size_t n) {
+   std::mt19937_64 rnd(42);
+   vector<unsigned> ints(n), intMisses(n);
+   for (auto& k : ints)
+      k = static_cast<unsigned>(rnd());
+   for (auto& k : intMisses)
+      k = static_cast<unsigned>(rnd());
+   benchMap<FlatHashMap<unsigned, unsigned>>(out, "hash_u32", "FlatHashMap", ints, intMisses);
+   benchMap<std::unordered_map<unsigned, unsigned>>(out, "hash_u32", "std::unordered_map", ints, intMisses);
+
+   vector<string> strs(n), strMisses(n);
+   for (std::size_t i = 0; i < n; i++) {
+      strs[i] = "OrdId" + std::to_string(rnd());
+      strMisses[i] = "OrdId" + std::to_string(rnd());
+   }
+   benchMap<FlatHashMap<string, unsigned>>(out, "hash_str", "FlatHashMap", strs, strMisses);
+   benchMap<std::unordered_map<string, unsigned>>(out, "hash_str", "std::unordered_map", strs, strMisses);
+}
+
+// single operation of the workload, _arg is the order, user or security index
+struct Op {
+   OpKind _kind;
+   unsigned _arg;
+   unsigned _qty; // minQty of opCancelSec
+};
+
+// pregenerated operations of one thread, so the generation isn't timed
+struct Stream {
+   vector<Order> _orders;
+   vector<Op> _ops;
+};
+
+// orders get the thread prefix, so the threads never collide on the order id
+Order randomOrder(const Workload& load, const string& prefix, std::size_t i, std::mt19937& rnd) {
+   const WorkloadConfig& cfg = load.config();
+   unsigned user = rnd() % cfg._users;
+   unsigned sec = rnd() % cfg._secs;
+   bool buy = rnd() & 1;
+   return load.order(prefix + std::to_string(i), sec, user, load.qty(rnd), buy);
+}
+
+//
+Stream makeStream(const Workload& load, unsigned thread) {
+   const WorkloadConfig& cfg = load.config();
+   Stream s;
+   std::mt19937 rnd = load.random(thread);
+   std::discrete_distribution<unsigned> mix = load.mix();
+   string prefix = "T" + std::to_string(thread) + "Ord";
+   s._ops.reserve(cfg._ops);
+   for (std::size_t i = 0; i < cfg._ops; i++) {
+      Op op{static_cast<OpKind>(mix(rnd)), 0, 0};
+      switch (op._kind) {
+      case opAdd:
+         op._arg = static_cast<unsigned>(s._orders.size());
+         s._orders.push_back(randomOrder(load, prefix, s._orders.size(), rnd));
+         break;
+      case opCancel:
+         if (s._orders.empty())
+            continue; // nothing added yet
+         op._arg = rnd() % s._orders.size();
+         break;
+      case opCancelUser:
+         op._arg = rnd() % cfg._users;
+         break;
+      case opCancelSec:
+         op._arg = rnd() % cfg._secs;
+         op._qty = cfg._maxQty - rnd() % (cfg._maxQty / 10 + 1); // the top tenth of qty
+         break;
+      default:
+         op._arg = rnd() % cfg._secs;
+      }
+      s._ops.push_back(op);
+   }
+   return s;
+}
+
+using Samples = std::array<vector<uint32_t>, opKinds>;
+
+// runs the stream, latency of every operation is recorded
+void runStream(OrderCacheInterface& cache, const Workload& load, const Stream& s, Samples& samples) {
+   unsigned sum = 0;
+   for (const Op& op : s._ops) {
+      auto start = Clock::now();
+      switch (op._kind) {
+      case opAdd:
+         cache.addOrder(s._orders[op._arg]);
+         break;
+      case opCancel:
+         cache.cancelOrder(s._orders[op._arg].orderId());
+         break;
+      case opCancelUser:
+         cache.cancelOrdersForUser(load.user(op._arg));
+         break;
+      case opCancelSec:
+         cache.cancelOrdersForSecIdWithMinimumQty(load.sec(op._arg), op._qty);
+         break;
+      case opMatch:
+         sum += cache.getMatchingSizeForSecurity(load.sec(op._arg));
+         break;
+      default:
+         sum += static_cast<unsigned>(cache.getAllOrders().size());
+      }
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+      samples[op._kind].push_back(static_cast<uint32_t>(std::min<long long>(ns, UINT32_MAX)));
+   }
+   querySink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+// the workload against a fresh cache, threads start together
+template <class Cache>
+void benchCache(const Reporter& out, const Config& cfg, const Workload& load, unsigned threads) {
+   Cache cache;
+   OrderCacheInterface& iface = cache;
+   std::mt19937 rnd(cfg._seed);
+   for (std::size_t i = 0; i < cfg._prefill; i++)
+      iface.addOrder(randomOrder(load, "PreOrd", i, rnd));
+
+   vector<Stream> streams;
+   for (unsigned t = 0; t < threads; t++)
+      streams.push_back(makeStream(load, t));
+   vector<Samples> samples(threads);
+   for (unsigned t = 0; t < threads; t++) {
+      for (auto& s : samples[t])
+         s.reserve(cfg._ops);
+   }
+
+   std::latch start(threads + 1);
+   vector<std::thread> workers;
+   for (unsigned t = 0; t < threads; t++) {
+      workers.emplace_back([&, t] {
+         start.arrive_and_wait();
+         runStream(iface, load, streams[t], samples[t]);
+      });
+   }
+   start.arrive_and_wait();
+   auto begin = Clock::now();
+   for (auto& w : workers)
+      w.join();
+   double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+   string table = cfg._cache + "/" + hashMapName;
+   vector<uint32_t> total;
+   for (unsigned op = 0; op < opKinds; op++) {
+      vector<uint32_t> ns;
+      for (auto& s : samples)
+         ns.insert(ns.end(), s[op].begin(), s[op].end());
+      total.insert(total.end(), ns.begin(), ns.end());
+      out.latency("cache", table, opNames[op], threads, ns, seconds);
+   }
+   out.latency("cache", table, "total", threads, total, seconds);
+}
+
+} // namespace
+
+//
+int runBenchmark(int argc, char* argv[]) {
+   Config cfg;
+   if (!parseArgs(argc, argv, cfg)) {
+      usage();
+      return 1;
+   }
+   Reporter out(cfg._json);
+   if (cfg._hash)
+      benchHashTables(out, cfg._ops);
+   Workload load(cfg);
+   for (unsigned threads : cfg._threads) {
+      if ("sharded" == cfg._cache)
+         benchCache<ShardedOrderCacheImpl>(out, cfg, load, threads);
+      else
+         benchCache<OrderCacheImpl>(out, cfg, load, threads);
+   }
+   return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// benchmarks of the cache and its containers, started by "tradeweb bench [key=value ...]":
+// synthetic workloads of OrderCacheInterface calls, single and multi threaded, with latency
+// percentiles and throughput per operation, as text or JSON lines (format=json) to diff the builds
+int runBenchmark(int argc, char* argv[]);
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "OrderCacheCheck.h"
+#include "OrderCacheImpl.h"
+#include "OrderJournal.h"
+#include "ShardedOrderCacheImpl.h"
+
+using std::cout; using std::cerr; using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+
+// counts and prints the first failures of the check
+class Failures {
+public:
+   explicit Failures(const char* check) : m_check(check) {}
+
+   void fail(const string& what) {
+      if (m_count++ < 10)
+         cerr << m_check << ": " << what << endl;
+   }
+
+   // prints the result line of the check
+   bool report() const {
+      cout << "check\t" << m_check << "\t" << (m_count ? "FAILED, " + std::to_string(m_count) + " errors" : "ok") << endl;
+      return !m_count;
+   }
+
+private:
+   const char* m_check;
+   std::size_t m_count = 0;
+};
+
+using OrderRow = std::tuple<string, string, string, unsigned, string, string>;
+
+// all orders of the cache, sorted by order id
+template <class Cache>
+vector<OrderRow> orderRows(const Cache& cache) {
+   vector<OrderRow> rows;
+   for (const Order& o : cache.getAllOrders())
+      rows.emplace_back(o.orderId(), o.securityId(), o.side(), o.qty(), o.user(), o.company());
+   std::sort(rows.begin(), rows.end());
+   return rows;
+}
+
+// the sharded cache against the plain one, after the same writes
+void compareCaches(const OrderCacheImpl& plain, const ShardedOrderCacheImpl& sharded, const vector<string>& secs,
+                   const vector<string>& users, const vector<string>& comps, std::size_t step, Failures& fails) {
+   string at = " after write " + std::to_string(step);
+   if (orderRows(plain) != orderRows(sharded))
+      fails.fail("getAllOrders() differs" + at);
+   for (auto& sec : secs) {
+      if (plain.matchingSize(sec) != sharded.matchingSize(sec))
+         fails.fail("matching size of " + sec + " differs" + at);
+   }
+   for (auto& user : users) {
+      OrderCacheImpl::SideQty p = plain.getOutstandingQtyForUser(user), s = sharded.getOutstandingQtyForUser(user);
+      if (p._buy != s._buy || p._sell != s._sell)
+         fails.fail("outstanding qty of user " + user + " differs" + at);
+   }
+   for (auto& comp : comps) {
+      OrderCacheImpl::SideQty p = plain.getOutstandingQtyForCompany(comp), s = sharded.getOutstandingQtyForCompany(comp);
+      if (p._buy != s._buy || p._sell != s._sell)
+         fails.fail("outstanding qty of company " + comp + " differs" + at);
+   }
+}
+
+// Differential check of ShardedOrderCacheImpl: the same writes go to it and to OrderCacheImpl,
+// the queries have to give the same. The orders of the user come with different companies
+// and go to different shards, the user has to stay with the company of the first order
+bool checkSharded() {
+   Failures fails("sharded");
+   const unsigned secCount = 16, userCount = 12, compCount = 4;
+   vector<string> secs, users, comps;
+   for (unsigned i = 0; i < secCount; i++)
+      secs.push_back("SecId" + std::to_string(i));
+   for (unsigned i = 0; i < userCount; i++)
+      users.push_back("User" + std::to_string(i));
+   for (unsigned i = 0; i < compCount; i++)
+      comps.push_back("Comp" + std::to_string(i));
+
+   OrderCacheImpl plain;
+   ShardedOrderCacheImpl sharded(4);
+   std::set<unsigned> shards;
+   for (auto& sec : secs)
+      shards.insert(static_cast<unsigned>(StrHash{}(sec) % sharded.shardCount()));
+   if (shards.size() < 2)
+      fails.fail("the securities don't span the shards");
+
+   // the first user gets the orders of every security, each with another company
+   for (unsigned i = 0; i < secCount; i++) {
+      Order order("Start" + std::to_string(i), secs[i], (i & 1) ? "Sell" : "Buy", 100 + i, users[0], comps[i % compCount]);
+      plain.addOrder(order);
+      sharded.addOrder(order);
+   }
+   compareCaches(plain, sharded, secs, users, comps, 0, fails);
+
+   std::mt19937 rnd(12345);
+   std::size_t nextId = 0;
+   const std::size_t writes = 20000;
+   for (std::size_t step = 1; step <= writes; step++) {
+      unsigned op = rnd() % 100;
+      if (op < 60) {
+         Order order("Ord" + std::to_string(nextId++), secs[rnd() % secCount], (rnd() & 1) ? "Buy" : "Sell",
+                     1 + rnd() % 1000, users[rnd() % userCount], comps[rnd() % compCount]);
+         plain.addOrder(order);
+         sharded.addOrder(order);
+      }
+      else if (op < 95) {
+         string id = "Ord" + std::to_string(nextId ? rnd() % nextId : 0);
+         plain.cancelOrder(id);
+         sharded.cancelOrder(id);
+      }
+      else if (op < 97) {
+         const string& user = users[rnd() % userCount];
+         plain.cancelOrdersForUser(user);
+         sharded.cancelOrdersForUser(user);
+      }
+      else {
+         const string& sec = secs[rnd() % secCount];
+         unsigned minQty = 1 + rnd() % 1000;
+         plain.cancelOrdersForSecIdWithMinimumQty(sec, minQty);
+         sharded.cancelOrdersForSecIdWithMinimumQty(sec, minQty);
+      }
+      if (0 == step % 500)
+         compareCaches(plain, sharded, secs, users, comps, step, fails);
+   }
+   return fails.report();
+}
+
+// The journal, which can't start the next generation at checkpoint: the checkpoint fails,
+// the writes throw after it, and the recovery gets everything written before the failure
+bool checkJournal() {
+   Failures fails("journal");
+   std::error_code ec;
+   std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / "tradeweb-check";
+   std::filesystem::remove_all(dir, ec);
+   std::filesystem::create_directories(dir, ec);
+   string base = (dir / "orders").string();
+
+   vector<OrderRow> expected;
+   {
+      OrderCacheImpl cache;
+      OrderJournal journal(base);
+      if (!journal.recover(cache)) {
+         fails.fail("can't start the journal in " + dir.string());
+         return fails.report();
+      }
+      cache.addOrder(Order("Ord1", "SecId1", "Buy", 100, "User1", "Comp1"));
+      cache.addOrder(Order("Ord2", "SecId1", "Sell", 200, "User2", "Comp2"));
+      cache.addOrder(Order("Ord3", "SecId2", "Buy", 300, "User1", "Comp1"));
+      cache.cancelOrder("Ord2");
+      if (!journal.flush())
+         fails.fail("flush() of the good journal has failed");
+      expected = orderRows(cache);
+
+      // the directory takes the name of the next generation
+      std::filesystem::create_directory(base + ".1.jrn", ec);
+      if (journal.checkpoint(cache))
+         fails.fail("checkpoint() hasn't reported the failed rotation");
+      if (!journal.failed())
+         fails.fail("the journal hasn't failed");
+      bool thrown = false;
+      try {
+         cache.addOrder(Order("Ord4", "SecId2", "Sell", 400, "User2", "Comp2"));
+      }
+      catch (const string&) {
+         thrown = true;
+      }
+      if (!thrown)
+         fails.fail("addOrder() after the failure hasn't thrown");
+      if (3 != cache.size())
+         fails.fail("the order, which has failed the journal, isn't in the cache");
+      if (journal.flush())
+         fails.fail("flush() of the failed journal has succeeded");
+   }
+   if (std::filesystem::exists(base + ".snap", ec))
+      fails.fail("the snapshot is written after the failed rotation");
+
+   std::filesystem::remove(base + ".1.jrn", ec);
+   OrderCacheImpl cache;
+   OrderJournal journal(base);
+   if (!journal.recover(cache))
+      fails.fail("can't recover after the failure");
+   else if (orderRows(cache) != expected)
+      fails.fail("the recovered orders differ from the ones written before the failure");
+   std::filesystem::remove_all(dir, ec);
+   return fails.report();
+}
+
+// The order id, which the journal record can't keep, fails the journal in the middle of
+// cancelOrdersForUser(): the cancel is still done completely, then it throws
+bool checkLongString() {
+   Failures fails("long string");
+   std::error_code ec;
+   std::filesystem::path dir = std::filesystem::temp_directory_path(ec) / "tradeweb-check";
+   std::filesystem::remove_all(dir, ec);
+   std::filesystem::create_directories(dir, ec);
+   {
+      OrderCacheImpl cache;
+      OrderJournal journal((dir / "orders").string());
+      if (!journal.recover(cache)) {
+         fails.fail("can't start the journal in " + dir.string());
+         return fails.report();
+      }
+      string longId(70000, 'L');
+      cache.addOrder(Order("Ord1", "SecId1", "Buy", 100, "User1", "Comp1"));
+      cache.attachJournal(nullptr);
+      cache.addOrder(Order(longId, "SecId1", "Sell", 200, "User1", "Comp1"));
+      cache.addOrder(Order("Ord3", "SecId2", "Sell", 300, "User1", "Comp1"));
+      cache.addOrder(Order("Ord4", "SecId1", "Sell", 400, "User2", "Comp2"));
+      cache.attachJournal(&journal);
+      bool thrown = false;
+      try {
+         cache.cancelOrdersForUser("User1");
+      }
+      catch (const string&) {
+         thrown = true;
+      }
+      if (!thrown)
+         fails.fail("cancelOrdersForUser() hasn't thrown");
+      if (!journal.failed())
+         fails.fail("the journal hasn't failed");
+      OrderCacheImpl::SideQty user = cache.getOutstandingQtyForUser("User1");
+      if (1 != cache.size() || user._buy || user._sell)
+         fails.fail("the orders of the user are left in the cache");
+      if (cache.matchingSize("SecId1"))
+         fails.fail("the matching size isn't published");
+      try {
+         cache.addOrder(Order("Ord5", "SecId1", "Buy", 500, "User1", "Comp1"));
+      }
+      catch (const string&) {
+         // the journal has failed, the order is in the cache anyway
+      }
+      if (2 != cache.size() || 400 != cache.matchingSize("SecId1"))
+         fails.fail("the user can't place the orders after the cancel");
+   }
+   std::filesystem::remove_all(dir, ec);
+   return fails.report();
+}
+
+// Snapshots of the large cache, taken by chunks while the writer runs. The writer adds the orders
+// of the user by single batch and cancels them by cancelOrdersForUser(), so every snapshot
+// has to have all orders of the user or none of them, whatever the writes between the chunks
+bool checkSnapshot() {
+   Failures fails("snapshot");
+   const unsigned users = 64, userOrders = 16, fillers = 50000, rounds = 3000;
+   OrderCacheImpl cache;
+   vector<Order> batch;
+   for (unsigned i = 0; i < fillers; i++)
+      batch.emplace_back("Fill" + std::to_string(i), "SecId" + std::to_string(i % 32), (i & 1) ? "Buy" : "Sell", 1 + i % 500,
+                         "Filler", "Comp0");
+   cache.addOrders(batch);
+
+   std::atomic<bool> done{false};
+   std::thread writer([&] {
+      std::mt19937 rnd(777);
+      std::size_t nextId = 0;
+      for (unsigned round = 0; round < rounds; round++) {
+         string user = "User" + std::to_string(rnd() % users);
+         cache.cancelOrdersForUser(user);
+         vector<Order> orders;
+         for (unsigned i = 0; i < userOrders; i++)
+            orders.emplace_back("Ord" + std::to_string(nextId++), "SecId" + std::to_string(rnd() % 32), (rnd() & 1) ? "Buy" : "Sell",
+                                1 + rnd() % 500, user, "Comp1");
+         cache.addOrders(orders);
+         // cancel some fillers, so the recycled slots of the new orders go below the copy too
+         cache.cancelOrder("Fill" + std::to_string(rnd() % fillers));
+      }
+      done = true;
+   });
+   std::size_t snapshots = 0;
+   while (!done || !snapshots) {
+      OrderSnapshot snap = cache.snapshot();
+      std::map<string, unsigned> perUser;
+      std::set<std::string_view> ids;
+      snap.forEach([&](const OrderView& o) {
+         if ("Filler" != o.user())
+            perUser[string(o.user())]++;
+         if (!ids.insert(o.orderId()).second)
+            fails.fail("order " + string(o.orderId()) + " is twice in the snapshot");
+      });
+      for (auto& [user, count] : perUser) {
+         if (userOrders != count)
+            fails.fail("snapshot " + std::to_string(snapshots) + " has " + std::to_string(count) + " orders of " + user);
+      }
+      snapshots++;
+   }
+   writer.join();
+   return fails.report();
+}
+
+} // namespace
+
+//
+int runCheck() {
+   bool ok = checkSharded();
+   ok = checkJournal() && ok;
+   ok = checkLongString() && ok;
+   ok = checkSnapshot() && ok;
+   return ok ? 0 : 1;
+}
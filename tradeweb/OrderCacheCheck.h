@@ -0,0 +1,6 @@
+#pragma once
+
+// deterministic self checks, started by "tradeweb check": every check runs a fixed scenario
+// and compares the results against the expected ones, the first differences are printed.
+// Returns 0 - all checks have passed
+int runCheck();
@@ -1,161 +1,518 @@
-#include <list>
+#include <algorithm>
+#include <vector>
 
 #include "OrderCacheImpl.h"
+#include "OrderJournal.h"
 
 using std::string;
-using std::make_shared;
 using namespace std::string_literals;
 
 static const std::string strBuy{"Buy"s};
-static const std::string strSell{"Sell"s};
 
 //
 void OrderCacheImpl::addOrder(Order order) {
-   StrShared id = make_shared<string>(order.orderId());
+   OpTimer ot(m_stats, statAddOrder);
    GuardWrite gw(m_lock);
-   auto orderRes = m_orders.insert({id, OrderShared{}});
+   reclaim();
+   insertOrder(OrderView(order));
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::addOrders(std::span<const Order> orders) {
+   OpTimer ot(m_stats, statAddBatch);
+   GuardWrite gw(m_lock);
+   reclaim();
+   reserve(orders.size());
+   for (const Order& order : orders)
+      insertOrder(OrderView(order));
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::addOrders(std::span<const Order* const> orders) {
+   OpTimer ot(m_stats, statAddBatch);
+   GuardWrite gw(m_lock);
+   reclaim();
+   reserve(orders.size());
+   for (const Order* order : orders)
+      insertOrder(OrderView(*order));
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::addOrders(std::span<const OrderView> orders) {
+   OpTimer ot(m_stats, statAddBatch);
+   GuardWrite gw(m_lock);
+   reclaim();
+   reserve(orders.size());
+   for (const OrderView& order : orders)
+      insertOrder(order);
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::reserve(std::size_t orders) {
+   m_orderIds.reserve(m_orderIds.size() + orders);
+   std::size_t slots = m_orderIds.size() + orders; // ids are dense, recycled ones are below
+   if (m_orders.capacity() < slots)
+      m_orders.reserve(std::max(slots, 2 * m_orders.capacity()));
+}
+
+//
+void OrderCacheImpl::insertOrder(const OrderView& order) {
+   Id orderId = claimOrder(order.orderId());
+   if (SymbolTable::none == orderId)
+      return;
+   auto userRes = m_userIds.insert(order.user());
+   User& user = slot(m_users, userRes.first);
+   if (userRes.second) // new user
+      user._comp = m_compIds.intern(m_dir ? m_dir->company(order.user(), order.company()) : order.company());
+   placeOrder(orderId, userRes.first, internSecurity(order.securityId()), order.qty(), strBuy == order.side());
+}
+
+//
+OrderCacheImpl::Id OrderCacheImpl::claimOrder(std::string_view orderId) {
+   auto orderRes = m_orderIds.insert(orderId);
    if (!orderRes.second)
-      return; // already exist
-   OrderShared sh_ord = make_shared<OrderImpl>();
-   orderRes.first->second = sh_ord;
-   sh_ord->m_id = id;
-   // assign user
-   StrShared user = make_shared<string>(order.user());
-   auto userRes = m_users.insert({user, User{}});
-   auto userIter = userRes.first;
-   if (userRes.second) { // new user
-      // have to search for the company
-      StrShared comp = make_shared<string>(order.company());
-      auto compRes = m_companies.insert(comp);
-      userIter->second._comp = *(compRes.first);
-   }
-   sh_ord->m_user = userIter->first;
-   sh_ord->m_comp = userIter->second._comp;
-   userIter->second._orders.insert(sh_ord);
-   // assign security
-   StrShared sec = make_shared<string>(order.securityId());
-   auto compRes = m_securs.insert({sec, OrderSet{}});
-   auto compIter = compRes.first;
-   sh_ord->m_sec = compIter->first;
-   compIter->second.insert(sh_ord);
-   sh_ord->m_qty = order.qty();
-   sh_ord->m_side = (strBuy == order.side());
+      return SymbolTable::none; // already exist
+   if (m_dir && !m_dir->claim(orderId)) {
+      m_orderIds.release(orderRes.first);
+      return SymbolTable::none; // exists in another cache of the owner
+   }
+   return orderRes.first;
+}
+
+//
+OrderCacheImpl::Id OrderCacheImpl::internSecurity(std::string_view securityId) {
+   auto secRes = m_secIds.insert(securityId);
+   if (secRes.second) { // new security
+      m_matching.add(securityId);
+      slot(m_securs, secRes.first);
+   }
+   return secRes.first;
+}
+
+//
+void OrderCacheImpl::placeOrder(Id orderId, Id userId, Id secId, unsigned qty, bool side) {
+   if (!m_copies.empty())
+      saveSlot(orderId);
+   OrderImpl& oi = slot(m_orders, orderId);
+   User& user = m_users[userId];
+   oi.m_user = userId;
+   oi.m_userPos = static_cast<std::uint32_t>(user._orders.size());
+   user._orders.push_back(orderId);
+   user._qty.add(side, qty);
+   slot(m_compQty, user._comp).add(side, qty);
+   oi.m_qty = qty;
+   oi.m_side = side;
+   oi.m_sec = secId;
+   Security& sec = m_securs[secId];
+   auto level = findLevel(sec._byQty, qty);
+   if (sec._byQty.end() == level || level->_qty != qty)
+      level = sec._byQty.insert(level, QtyLevel{qty, {}});
+   oi.m_secPos = static_cast<std::uint32_t>(level->_orders.size());
+   level->_orders.push_back(orderId);
+   sec.add(user._comp, side, qty);
+   touch(secId);
+   m_size.store(m_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+   if (m_notifier.wants(eventAdded))
+      m_notifier.added(entry(orderId), m_pins);
+   if (m_journal)
+      m_journal->add(OrderView(m_orderIds.name(orderId), m_secIds.name(secId), side ? "Buy" : "Sell", qty,
+                               m_userIds.name(userId), m_compIds.name(user._comp)),
+                     userId, user._comp, secId);
+}
+
+// the symbols are interned once, the orders refer them by the index
+void OrderCacheImpl::load(std::span<const std::string_view> users, std::span<const std::string_view> comps,
+                          std::span<const std::string_view> secs, std::span<const LoadOrder> orders) {
+   OpTimer ot(m_stats, statLoad);
+   GuardWrite gw(m_lock);
+   reclaim();
+   reserve(orders.size());
+   std::vector<Id> userIds(users.size()), compIds(comps.size()), secIds(secs.size());
+   for (std::size_t i = 0; i < users.size(); i++) {
+      userIds[i] = m_userIds.intern(users[i]);
+      slot(m_users, userIds[i]);
+   }
+   for (std::size_t i = 0; i < comps.size(); i++)
+      compIds[i] = m_compIds.intern(comps[i]);
+   for (std::size_t i = 0; i < secs.size(); i++)
+      secIds[i] = internSecurity(secs[i]);
+   for (const LoadOrder& order : orders) {
+      Id orderId = claimOrder(order._id);
+      if (SymbolTable::none == orderId)
+         continue;
+      User& user = m_users[userIds[order._user]];
+      if (SymbolTable::none == user._comp) // new user
+         user._comp = m_dir ? m_compIds.intern(m_dir->company(users[order._user], comps[order._comp])) : compIds[order._comp];
+      placeOrder(orderId, userIds[order._user], secIds[order._sec], order._qty, order._side);
+   }
+   publish(gw);
 }
 
 //
 void OrderCacheImpl::cancelOrder(const std::string& orderId) {
-   StrShared ss = make_shared<string>(orderId);
+   OpTimer ot(m_stats, statCancelOrder);
+   GuardWrite gw(m_lock);
+   removeOrder(orderId);
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::cancelOrders(std::span<const std::string> orderIds) {
+   OpTimer ot(m_stats, statCancelBatch);
    GuardWrite gw(m_lock);
-   cancelOrder(ss);
+   for (auto& id : orderIds)
+      removeOrder(id);
+   publish(gw);
 }
 
 //
-void OrderCacheImpl::cancelOrder(StrShared orderId) {
-   auto orderFound = m_orders.find(orderId);
-   if (m_orders.end() == orderFound)
-      return; // there is no more order
-   OrderImpl* po = orderFound->second.get();
-   // remove from user' index
-   auto userFound = m_users.find(po->m_user);
-   if (m_users.end() == userFound)
-      throw "cancelOrder::userNotFound"s;
-   auto cnt = userFound->second._orders.erase(orderFound->second);
-   if(!cnt)
+void OrderCacheImpl::cancelOrders(std::span<const std::string_view> orderIds) {
+   OpTimer ot(m_stats, statCancelBatch);
+   GuardWrite gw(m_lock);
+   for (auto id : orderIds)
+      removeOrder(id);
+   publish(gw);
+}
+
+//
+void OrderCacheImpl::removeOrder(std::string_view orderId) {
+   Id id = m_orderIds.find(orderId);
+   if (SymbolTable::none != id)
+      cancelOrder(id);
+}
+
+//
+bool OrderCacheImpl::removeFromList(OrderList& list, Id orderId, std::uint32_t OrderImpl::*pos) {
+   std::uint32_t at = m_orders[orderId].*pos;
+   if (list.size() <= at || list[at] != orderId)
+      return false;
+   Id last = list.back();
+   list[at] = last;
+   m_orders[last].*pos = at;
+   list.pop_back();
+   return true;
+}
+
+//
+void OrderCacheImpl::removeFromUser(Id orderId) {
+   if (!removeFromList(m_users[m_orders[orderId].m_user]._orders, orderId, &OrderImpl::m_userPos))
       throw "cancelOrder::userDoesntOwnSecurity"s;
-   // remove from security' index
-   auto secFound = m_securs.find(po->m_sec);
-   if (m_securs.end() == secFound)
-      throw "cancelOrder::securityNotFound"s;
-   cnt = secFound->second.erase(orderFound->second);
-   if (!cnt)
+}
+
+// the empty level is removed - min qty cancel doesn't walk them
+void OrderCacheImpl::removeFromSecurity(Id orderId) {
+   const OrderImpl& oi = m_orders[orderId];
+   QtyIndex& byQty = m_securs[oi.m_sec]._byQty;
+   auto level = findLevel(byQty, oi.m_qty);
+   if (byQty.end() == level || level->_qty != oi.m_qty || !removeFromList(level->_orders, orderId, &OrderImpl::m_secPos))
       throw "cancelOrder::securityIndexInvalid"s;
-   m_orders.erase(orderFound);
+   if (level->_orders.empty())
+      byQty.erase(level);
+}
+
+//
+OrderCacheImpl::QtyIndex::iterator OrderCacheImpl::findLevel(QtyIndex& index, unsigned qty) {
+   return std::lower_bound(index.begin(), index.end(), qty, [](const QtyLevel& level, unsigned q) { return level._qty < q; });
+}
+
+//
+void OrderCacheImpl::cancelOrder(Id orderId) {
+   removeFromSecurity(orderId);
+   releaseOrder(orderId);
+}
+
+//
+void OrderCacheImpl::releaseOrder(Id orderId) {
+   removeFromUser(orderId);
+   dropOrder(orderId);
+}
+
+//
+void OrderCacheImpl::dropOrder(Id orderId) {
+   if (!m_copies.empty())
+      saveSlot(orderId);
+   OrderImpl& oi = m_orders[orderId];
+   if (m_notifier.wants(eventCancelled))
+      m_notifier.cancelled(entry(orderId), m_pins);
+   User& user = m_users[oi.m_user];
+   user._qty.sub(oi.m_side, oi.m_qty);
+   m_compQty[user._comp].sub(oi.m_side, oi.m_qty);
+   m_securs[oi.m_sec].remove(user._comp, oi.m_side, oi.m_qty);
+   touch(oi.m_sec);
+   m_size.store(m_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+   oi = OrderImpl{};
+   if (m_dir)
+      m_dir->release(m_orderIds.name(orderId));
+   if (m_journal)
+      m_journal->cancel(m_orderIds.name(orderId));
+   // strings of the order id may be still referred by the snapshots
+   m_orderIds.retire(orderId);
+   if (m_pins.load(std::memory_order_acquire))
+      m_retired.push_back(orderId);
+   else
+      m_orderIds.recycle(orderId);
+}
+
+//
+void OrderCacheImpl::reclaim() {
+   if (m_retired.empty() || m_pins.load(std::memory_order_acquire))
+      return;
+   for (Id id : m_retired)
+      m_orderIds.recycle(id);
+   m_retired.clear();
 }
 
 // remove all orders in the cache for this user
 void OrderCacheImpl::cancelOrdersForUser(const std::string& user) {
-   StrShared su = make_shared<string>(user);
+   OpTimer ot(m_stats, statCancelUser);
    GuardWrite gw(m_lock);
-   auto userFound = m_users.find(su);
-   if (m_users.end() == userFound)
+   Id userId = m_userIds.find(user);
+   if (SymbolTable::none == userId)
       return; // there is no such user
-   OrderSet& orders  = userFound->second._orders;
-   while (!orders.empty()) {
-      cancelOrder(orders.begin()->get()->m_id);
+   OrderList& orders = m_users[userId]._orders;
+   if (orders.empty())
+      return;
+   for (Id orderId : orders) {
+      removeFromSecurity(orderId);
+      dropOrder(orderId);
    }
+   orders.clear();
+   publish(gw);
 }
 
 // remove all orders in the cache for this security with qty >= minQty
 void OrderCacheImpl::cancelOrdersForSecIdWithMinimumQty(const std::string& securityId, unsigned int minQty) {
-   StrShared ss = make_shared<string>(securityId);
+   OpTimer ot(m_stats, statCancelSecMinQty);
    GuardWrite gw(m_lock);
-   auto secFound = m_securs.find(ss);
-   if (m_securs.end() == secFound)
+   Id secId = m_secIds.find(securityId);
+   if (SymbolTable::none == secId)
       return; // no such security
-   // first gather all ids
-   std::list<StrShared> lo;
-   for (auto so : secFound->second) {
-      if (so->m_qty >= minQty)
-         lo.push_back(so->m_id);
-   }
-   for (auto id : lo) {
-      cancelOrder(id);
-   }
+   // the qualifying orders are the tail levels of the index - release them and cut the tail at once
+   QtyIndex& byQty = m_securs[secId]._byQty;
+   auto first = findLevel(byQty, minQty);
+   for (auto it = first; byQty.end() != it; ++it)
+      for (Id orderId : it->_orders)
+         releaseOrder(orderId);
+   byQty.erase(first, byQty.end());
+   publish(gw);
+}
+
+//
+OrderCacheImpl::SideQty OrderCacheImpl::getOutstandingQtyForUser(std::string_view user) const {
+   OpTimer ot(m_stats, statOutstanding);
+   GuardRead gr(m_lock);
+   Id userId = m_userIds.find(user);
+   return SymbolTable::none == userId ? SideQty{} : m_users[userId]._qty;
+}
+
+//
+OrderCacheImpl::SideQty OrderCacheImpl::getOutstandingQtyForCompany(std::string_view company) const {
+   OpTimer ot(m_stats, statOutstanding);
+   GuardRead gr(m_lock);
+   Id compId = m_compIds.find(company);
+   return SymbolTable::none == compId || m_compQty.size() <= compId ? SideQty{} : m_compQty[compId];
 }
 
 // return the total qty that can match for the security id
 unsigned  OrderCacheImpl::getMatchingSizeForSecurity(const std::string& securityId) {
-   StrShared ss = make_shared<string>(securityId);
-   GuardRead gw(m_lock);
-   auto secFound = m_securs.find(ss);
-   if (m_securs.end() == secFound)
-      return 0; // no such security
-   CompQtyList buy;
-   CompQtyList sell;
-   unsigned total = 0;
-   // for each order find match, what's not matched, add to list
-   for (auto so : secFound->second) {
-      unsigned qtyRest = so->m_qty;
-      CompQtyList& otherSide = so->m_side ? sell : buy;
-      for (auto iter = otherSide.begin(); (otherSide.end() != iter) && (qtyRest > 0); ) {
-         if (iter->_comp != so->m_comp) {
-            unsigned qtyCurr = iter->_qty;
-            unsigned matched = qtyCurr > qtyRest ? qtyRest : qtyCurr;
-            qtyRest -= matched;
-            total += matched;
-            iter->_qty -= matched;
-            if (!iter->_qty)
-               iter = otherSide.erase(iter);
-            else
-               ++iter;
-         }
-         else {
-            ++iter;
+   return matchingSize(securityId);
+}
+
+//
+void OrderCacheImpl::touch(Id secId) {
+   Security& sec = m_securs[secId];
+   if (!sec._dirty) {
+      sec._dirty = true;
+      m_dirty.push_back(secId);
+   }
+}
+
+// once per security per write - cancelOrdersForUser() may touch it many times
+void OrderCacheImpl::publish(GuardWrite& gw) {
+   bool notify = m_notifier.wants(eventMatching);
+   for (Id secId : m_dirty) {
+      Security& sec = m_securs[secId];
+      unsigned matching = sec.matchingSize();
+      if (notify && matching != sec._matching)
+         m_notifier.matching(&m_secIds.name(secId), sec._matching, matching);
+      sec._matching = matching;
+      m_matching.store(secId, matching);
+      sec._dirty = false;
+   }
+   m_dirty.clear();
+   if constexpr (OrderCacheStats::enabled) {
+      m_stats.sampleTable(tableOrders, m_orderIds.buckets(), m_orderIds.loadFactor(), m_orderIds.rehashes());
+      m_stats.sampleTable(tableUsers, m_userIds.buckets(), m_userIds.loadFactor(), m_userIds.rehashes());
+      m_stats.sampleTable(tableCompanies, m_compIds.buckets(), m_compIds.loadFactor(), m_compIds.rehashes());
+      m_stats.sampleTable(tableSecurities, m_secIds.buckets(), m_secIds.loadFactor(), m_secIds.rehashes());
+   }
+   // read under the lock - deliver() releases it, and the next writer may change the journal
+   bool lost = m_journal && m_journal->failed();
+   m_notifier.deliver(gw);
+   // the change is complete in the cache, but it isn't in the journal
+   if (lost)
+      throw "OrderJournal::writeFailed"s;
+}
+
+//
+template <bool Buy>
+void OrderCacheImpl::Security::add(Id comp, unsigned qty) {
+   auto slotRes = _slots.try_emplace(comp, static_cast<std::uint32_t>(_comps.size()));
+   if (slotRes.second) { // new active company
+      _comps.push_back(comp);
+      _buy.push_back(0);
+      _sell.push_back(0);
+   }
+   sideQty<Buy>()[slotRes.first->second] += qty;
+   sideTotal<Buy>() += qty;
+}
+
+// keep only active companies - they are walked by matchingSize(), the last one takes the place
+template <bool Buy>
+void OrderCacheImpl::Security::remove(Id comp, unsigned qty) {
+   auto slotFound = _slots.find(comp);
+   if (_slots.end() == slotFound)
+      throw "Security::remove::companyNotFound"s;
+   std::uint32_t at = slotFound->second;
+   sideQty<Buy>()[at] -= qty;
+   sideTotal<Buy>() -= qty;
+   if (_buy[at] || _sell[at])
+      return;
+   _slots.erase(slotFound);
+   std::uint32_t last = static_cast<std::uint32_t>(_comps.size() - 1);
+   if (at != last) {
+      _comps[at] = _comps[last];
+      _buy[at] = _buy[last];
+      _sell[at] = _sell[last];
+      _slots[_comps[at]] = at;
+   }
+   _comps.pop_back();
+   _buy.pop_back();
+   _sell.pop_back();
+}
+
+// The orders form bipartite graph buy -> sell, where only the different companies are connected.
+// Min cut of it has to leave uncut either no buys, or no sells, or single company on both sides:
+//    matching = min(B, S, min over companies (B - b[c] + S - s[c]))
+// It's the maximum possible matching, which doesn't depend on the order of the orders
+unsigned OrderCacheImpl::Security::matchingSize() const {
+   unsigned long long maxComp = 0; // max over companies b[c] + s[c]
+   const unsigned long long* buy = _buy.data();
+   const unsigned long long* sell = _sell.data();
+   for (std::size_t i = 0, n = _comps.size(); i < n; i++)
+      maxComp = std::max(maxComp, buy[i] + sell[i]);
+   unsigned long long total = std::min(_total._buy, _total._sell);
+   total = std::min(total, _total._buy + _total._sell - maxComp);
+   return static_cast<unsigned>(total);
+}
+
+// The small cache is copied at once. The large one by chunks: the writers get the lock between
+// them and keep the old entries of the slots they change ahead of the copy, see saveSlot()
+OrderSnapshot OrderCacheImpl::snapshot() const {
+   OpTimer ot(m_stats, statSnapshot);
+   OrderSnapshot snap;
+   GuardRead gr(m_lock);
+   if (m_orders.size() <= snapshotChunk) {
+      fillSnapshot(snap);
+      return snap;
+   }
+   SnapshotCopy copy(static_cast<Id>(m_orders.size()));
+   snap.pin(m_pins);
+   snap.reserve(m_orderIds.size());
+   auto unregister = [this, &copy] {
+      std::lock_guard<std::mutex> lg(m_copiesLock);
+      m_copies.erase(std::find(m_copies.begin(), m_copies.end(), &copy));
+   };
+   {
+      std::lock_guard<std::mutex> lg(m_copiesLock);
+      m_copies.push_back(&copy);
+   }
+   try {
+      for (;;) {
+         Id end = std::min<Id>(copy._end, copy._next + snapshotChunk);
+         for (Id id = copy._next; id < end; id++) {
+            auto before = copy._before.empty() ? copy._before.end() : copy._before.find(id);
+            OrderSnapshot::Entry e = copy._before.end() == before ? slotEntry(id) : before->second;
+            if (e._id)
+               snap.add(e);
          }
+         copy._next = end;
+         if (copy._end == end)
+            break;
+         gr.unlock();
+         gr.lock();
       }
-      if (qtyRest) { // still have unmatched qty - add it to same company
-         CompQtyList& sameSide = so->m_side ? buy : sell;
-         auto iterComp = std::find_if(sameSide.begin(), sameSide.end(), [&so](CompQty& cq) { return so->m_comp == cq._comp; });
-         if (sameSide.end() == iterComp)
-            sameSide.push_front({so->m_comp, qtyRest});
-         else
-            iterComp->_qty += qtyRest;
-      }
    }
-   return total;
+   catch (...) {
+      unregister();
+      throw;
+   }
+   unregister();
+   return snap;
 }
 
 //
-std::vector<Order> OrderCacheImpl::getAllOrders() const {
-   std::vector<Order> orders;
-   GuardRead gw(m_lock);
-   for (auto po : m_orders) {
-      OrderImpl* oi = po.second.get();
-      Order ord(*(oi->m_id), *(oi->m_sec), (oi->m_side ? strBuy : strSell), oi->m_qty, *(oi->m_user), *(oi->m_comp));
-      orders.emplace_back(std::move(ord));
+void OrderCacheImpl::attachJournal(OrderJournal* journal) {
+   GuardWrite gw(m_lock);
+   m_journal = journal;
+}
+
+// under the write lock - no change can get between the snapshot and the new journal
+OrderSnapshot OrderCacheImpl::checkpoint() {
+   OrderSnapshot snap;
+   GuardWrite gw(m_lock);
+   fillSnapshot(snap);
+   if (m_journal)
+      m_journal->rotate();
+   return snap;
+}
+
+//
+void OrderCacheImpl::fillSnapshot(OrderSnapshot& snap) const {
+   snap.pin(m_pins);
+   snap.reserve(m_orderIds.size());
+   for (Id id = 0; id < m_orders.size(); id++) {
+      const OrderImpl& oi = m_orders[id];
+      if (SymbolTable::none == oi.m_sec)
+         continue; // free slot
+      snap.add(entry(id));
+   }
+}
+
+//
+OrderSnapshot::Entry OrderCacheImpl::slotEntry(Id orderId) const {
+   return SymbolTable::none == m_orders[orderId].m_sec ? OrderSnapshot::Entry{} : entry(orderId);
+}
+
+// the first change of the slot after the start of the copy is the one, which matters
+void OrderCacheImpl::saveSlot(Id orderId) {
+   for (SnapshotCopy* copy : m_copies) {
+      if (copy->_next <= orderId && orderId < copy->_end)
+         copy->_before.try_emplace(orderId, slotEntry(orderId));
    }
-   return orders;
 }
 
+//
+OrderSnapshot::Entry OrderCacheImpl::entry(Id orderId) const {
+   const OrderImpl& oi = m_orders[orderId];
+   return {&m_orderIds.name(orderId), &m_secIds.name(oi.m_sec), &m_userIds.name(oi.m_user),
+           &m_compIds.name(m_users[oi.m_user]._comp), oi.m_qty, oi.m_side != 0};
+}
 
+// lock statistics are kept by the lock itself
+void OrderCacheImpl::dumpStats(std::ostream& out) const {
+   m_stats.print(out);
+#ifdef ORDERCACHE_STATS
+   m_lock.stats().print(out);
+#endif
+}
 
+// strings are copied from the snapshot - writers are not blocked meanwhile
+std::vector<Order> OrderCacheImpl::getAllOrders() const {
+   OpTimer ot(m_stats, statAllOrders);
+   return snapshot().toOrders();
+}
@@ -1,31 +1,84 @@
 #pragma once
 
 #include <memory>
-#include <unordered_set>
-#include <unordered_map>
+#include <span>
+#include <atomic>
+#include <mutex>
 #include <shared_mutex>
+#include <type_traits>
+#include <compare>
+#include <ostream>
 
 #include "OrderCache.h"
+#include "OrderSnapshot.h"
+#include "OrderEvents.h"
+#include "OrderCacheStats.h"
+#include "MatchingTable.h"
+#include "SymbolTable.h"
 
 // Implementation selection explanation:
 //   1. The decisions were made toward maximizing the speed at the memory expense
-//   2. Orders are kept in the unordered_map
-//   3. In addition to make search faster, we keep 2 additional hashes, 
-//      indexed by m_user and m_securityId
+//   2. Orders are kept in the vector, indexed by the interned order id
+//   3. In addition to make search faster, we keep 2 additional indexes,
+//      by m_user and m_securityId. Those are contiguous arrays of order ids, the security one
+//      is split into the levels of the same qty, sorted by qty, so min qty cancel is the cut
+//      of its tail levels. The order record is the single node of both indexes - it keeps
+//      its position in either list, so cancel is O(1) swap-remove in both (plus the binary search
+//      of the level). cancelOrdersForUser() walks the user orders once without any hash lookup
+//      and drops the list at once. Users and companies keep their outstanding quantities
 //   4. To make search/compare even more faster and to avoid strings duplication,
-//      we keep all strings in single instance and all structures will use shared_ptr<string>
-//   5. There're certain improvements, that were not implemented due to time and C++ version constraints:
-//       - optimizing multithreading - currently shared locks are used;
-//       - improving memory management for faster deletion/allocation, etc.
-//       - cxx20 features will allow to avoid memory allocations just for the search 
-//       hopefully those can be discussed during the further interview steps
+//      all strings are interned into SymbolTable once, all structures keep dense 32-bit ids.
+//      Users, companies and securities get vectors indexed by their ids.
+//      Lookups use cxx20 transparent find() by std::string_view, so queries and misses don't allocate
+//   5. Every security keeps per-company buy/sell quantities, updated by add/cancel.
+//      Every write recomputes the matching size of the securities it touched - O(companies) -
+//      and publishes it in MatchingTable, so getMatchingSizeForSecurity() takes no lock,
+//      it's a lock-free lookup and an atomic load
+//   6. Order records are slots of m_orders, recycled together with the order ids.
+//      Hash indexes are HashMap - flat open addressing tables by default (see HashMap.h),
+//      with ORDERCACHE_STD_HASH their nodes come from NodePool slabs and are recycled on cancel
+//   7. Readers, which need all orders, take the snapshot - it copies just pointers to the interned
+//      strings. Cancelled order ids aren't recycled while any snapshot is alive, so its strings
+//      stay valid without holding the lock. Large caches are copied by chunks, the read lock is
+//      released between them. The writer, which changes the slot not copied yet, keeps its old
+//      entry for the copy (copy-on-write of the slot), so the snapshot is still the state at its start
+//   8. Optional OrderJournal gets every change under the write lock, see OrderJournal.h.
+//      Once it has failed, every write throws after the change is done
+//   9. Writers and getAllOrders() still share the single lock of the cache,
+//      ShardedOrderCacheImpl splits it by security. getAllOrders() copies the strings of large
+//      snapshots by parts on WorkerPool, after the lock is released
+//  10. Subscribers get the changes of every write in single batch - added and cancelled orders,
+//      new matching sizes - after the lock is released, see OrderNotifier
+//  11. ORDERCACHE_STATS compiles in the latency histograms of the operations and of the lock,
+//      see OrderCacheStats.h. Without it nothing is measured
 
 // ASSUMPTIONS:
 // UserIds are unique througout the cache, not per the company
 
+class OrderJournal;
+
+// Hooks of the owner, which keeps single index of the orders across several caches
+// (see ShardedOrderCacheImpl). Called under the write lock of the cache
+class OrderDirectory {
+public:
+   virtual ~OrderDirectory() = default;
+
+   // new order is being added, false - the id is already used elsewhere
+   virtual bool claim(std::string_view orderId) = 0;
+
+   // the order is cancelled
+   virtual void release(std::string_view orderId) = 0;
+
+   // the user is new to this cache - returns the company the owner has bound the user to,
+   // or binds the given one, if the user is new to the owner too. The view lives as long as the owner
+   virtual std::string_view company(std::string_view user, std::string_view company) = 0;
+};
+
 //
 class OrderCacheImpl : public OrderCacheInterface {
 public:
+   explicit OrderCacheImpl(OrderDirectory* dir = nullptr) : m_dir(dir) {}
+
    // add order to the cache
    virtual void addOrder(Order order);
 
@@ -39,121 +92,244 @@ public:
    virtual void cancelOrdersForSecIdWithMinimumQty(const std::string& securityId, unsigned int minQty);
 
    // return the total qty that can match for the security id
+   // lock-free - reads the size published by the last writer of the security
    virtual unsigned int getMatchingSizeForSecurity(const std::string& securityId);
+   unsigned matchingSize(std::string_view securityId) const {
+      OpTimer ot(m_stats, statMatching);
+      return m_matching.load(securityId);
+   }
 
    // return all orders in cache in a vector
    virtual std::vector<Order> getAllOrders() const;
 
-private:
+   // number of live orders, without any lock - it may be behind the running writer
+   std::size_t size() const { return m_size.load(std::memory_order_relaxed); }
 
-   using StrShared = std::shared_ptr<std::string>;
+   // batch versions - the write lock is taken once for the whole batch,
+   // the indexes are grown once in advance
+   void addOrders(std::span<const Order> orders);
+   void addOrders(std::span<const Order* const> orders);
+   void addOrders(std::span<const OrderView> orders); // the strings are copied just once, when interned
+   void cancelOrders(std::span<const std::string> orderIds);
+   void cancelOrders(std::span<const std::string_view> orderIds);
 
-   void cancelOrder(StrShared orderId);
+   // outstanding quantities on both sides - of the user, of the company, etc.
+   struct SideQty {
+      unsigned long long _buy = 0;
+      unsigned long long _sell = 0;
 
-   // there're additional members which are to be used with cxx20 find() template
-   struct StrSharedEqual {
-      using is_transparent = void;  
+      void add(bool side, unsigned qty) { (side ? _buy : _sell) += qty; }
+      void sub(bool side, unsigned qty) { (side ? _buy : _sell) -= qty; }
+   };
 
-      bool operator()(const StrShared& ss1, const StrShared& ss2) const  noexcept {
-         return *ss1 == *ss2;
-      }
-      
-      bool operator()(const std::string& s1, const StrShared& ss2) const  noexcept {
-         return s1 == *ss2;
-      }
-      
-      bool operator()(const StrShared& ss1, const std::string& s2) const  noexcept {
-         return *ss1 == s2;
+   // kept up to date by every change, zeros - no such user or company
+   SideQty getOutstandingQtyForUser(std::string_view user) const;
+   SideQty getOutstandingQtyForCompany(std::string_view company) const;
+
+   // walks all orders under the read lock, visit(const OrderView&) - nothing is copied
+   template <class Visitor>
+   void forEachOrder(Visitor&& visit) const {
+      GuardRead gr(m_lock);
+      for (Id id = 0; id < m_orders.size(); id++) {
+         const OrderImpl& oi = m_orders[id];
+         if (SymbolTable::none == oi.m_sec)
+            continue; // free slot
+         visit(OrderView(m_orderIds.name(id), m_secIds.name(oi.m_sec), oi.m_side ? "Buy" : "Sell", oi.m_qty,
+                         m_userIds.name(oi.m_user), m_compIds.name(m_users[oi.m_user]._comp)));
       }
+   }
+
+   // copy of the orders, which can be walked without any lock, see OrderSnapshot.
+   // The writers wait for single chunk of the copy at most, not for the whole one
+   OrderSnapshot snapshot() const;
+
+   // order of load(), its symbols are the indexes in the symbol lists
+   struct LoadOrder {
+      std::string_view _id;
+      std::uint32_t    _user;
+      std::uint32_t    _comp;
+      std::uint32_t    _sec;
+      unsigned         _qty;
+      bool             _side; // true - "Buy"
    };
 
-   // there're additional members which are to be used with cxx20 find() template
-   struct StrSharedHash {
-      using is_transparent = void; 
+   // bulk load, e.g. of the snapshot file: every symbol is interned once, not per order.
+   // The orders sorted by qty within the security go to its index by appends
+   void load(std::span<const std::string_view> users, std::span<const std::string_view> comps,
+             std::span<const std::string_view> secs, std::span<const LoadOrder> orders);
 
-      std::size_t operator()(const StrShared& ss) const noexcept {
-         return std::hash<std::string>{}(*ss);
-      }
+   // all further changes are written to the journal, nullptr - stop it
+   void attachJournal(OrderJournal* journal);
 
-      std::size_t operator()(const std::string& s) const noexcept {
-         return std::hash<std::string>{}(s);
-      }
-   };
+   // snapshot and the journal rotation at once - the new journal starts right after it
+   OrderSnapshot checkpoint();
 
-   using StrSharedSet = std::unordered_set<StrShared, StrSharedHash, StrSharedEqual>; 
+   // changes of the following writes go to the subscriber, events - OrderEventKind mask.
+   // The subscriber must not change the cache, see OrderSubscriber
+   void subscribe(OrderSubscriber* subscriber, unsigned events = eventAll) { m_notifier.subscribe(subscriber, events); }
+   void unsubscribe(OrderSubscriber* subscriber) { m_notifier.unsubscribe(subscriber); }
 
-   //
-   struct OrderImpl {
-      StrShared m_id;
-      StrShared m_user;
-      StrShared m_comp;
-      StrShared m_sec;
-      bool      m_side;  // true - "Buy"
-      unsigned  m_qty;
-   };
+   // operations, lock and symbol tables statistics, if they're compiled in (ORDERCACHE_STATS)
+   void dumpStats(std::ostream& out) const;
 
-   using OrderShared = std::shared_ptr<OrderImpl>;
+private:
 
-   using StrOrderMap = std::unordered_map<StrShared, OrderShared, StrSharedHash, StrSharedEqual>;
+   using Id = SymbolTable::Id;
 
-   // there're additional members which are to be used with cxx20 find() template
-   struct OrderSharedEqual {
-      using is_transparent = void;
+   // writers and the readers of the orders share the lock
+#ifdef ORDERCACHE_STATS
+   using Lock = StatLock<std::shared_mutex>;
+#else
+   using Lock = std::shared_mutex;
+#endif
+   using GuardWrite = std::unique_lock<Lock>;
+   using GuardRead = std::shared_lock<Lock>;
 
-      bool operator()(const OrderShared& o1, const OrderShared& o2) const  noexcept {
-         return *(o1->m_id) == *(o2->m_id);
-      }
-      
-      bool operator()(const std::string& s1, const OrderShared& o2) const  noexcept {
-         return s1 == *(o2->m_id);
-      }
-      
-      bool operator()(const OrderShared& o1, const std::string& s2) const  noexcept {
-         return *(o1->m_id) == s2;
-      }
+   // all of them expect the write lock is taken
+   void reserve(std::size_t orders);
+   void insertOrder(const OrderView& order);
+   Id claimOrder(std::string_view orderId); // interns the new order id, none - it's used already
+   Id internSecurity(std::string_view securityId);
+   void placeOrder(Id orderId, Id userId, Id secId, unsigned qty, bool side); // user has the company already
+   void removeOrder(std::string_view orderId);
+   void cancelOrder(Id orderId);
+   void releaseOrder(Id orderId); // everything, but the security index
+   void dropOrder(Id orderId); // everything, but the security index and the user list
+   void reclaim(); // recycles retired order ids, if there are no snapshots
+   void fillSnapshot(OrderSnapshot& snap) const;
+   OrderSnapshot::Entry entry(Id orderId) const; // pointers to the strings of the order
+   OrderSnapshot::Entry slotEntry(Id orderId) const; // the one of entry(), null _id - the slot is free
+   void saveSlot(Id orderId); // the slot is going to change, the copies in progress keep its entry
+   void touch(Id secId); // the matching size of the security has to be published
+   // stores the matching sizes of the touched securities, releases the lock and delivers the changes
+   void publish(GuardWrite& gw);
+
+   // order id is the index in m_orders. The company is the one of the user, the side
+   // takes the top bit of the user id, so the record is 20 bytes, 3 of them per cache line
+   struct OrderImpl {
+      std::uint32_t m_user : 31 = 0;
+      std::uint32_t m_side : 1 = 0;   // 1 - "Buy"
+      Id            m_sec = SymbolTable::none;  // none - the slot is free
+      unsigned      m_qty = 0;
+      std::uint32_t m_userPos = 0;  // position in User::_orders
+      std::uint32_t m_secPos = 0;   // position in QtyLevel::_orders
    };
+   static_assert(sizeof(OrderImpl) == 20);
 
-   // there're additional members which are to be used with cxx20 find() template
-   struct OrderSharedHash {
-      using is_transparent = void;
+   // contiguous list of order ids, every order knows its position in it
+   using OrderList = std::vector<Id>;
 
-      std::size_t operator()(const OrderShared& o) const noexcept {
-         return std::hash<std::string>{}(*(o->m_id));
-      }
+   // O(1) removal - the last order takes the place of the removed one,
+   // pos is the member of OrderImpl with the position in the list. false - it's not there
+   bool removeFromList(OrderList& list, Id orderId, std::uint32_t OrderImpl::*pos);
+   void removeFromUser(Id orderId);
+   void removeFromSecurity(Id orderId);
 
-      std::size_t operator()(const std::string& s) const noexcept {
-         return std::hash<std::string>{}(s);
-      }
+   // orders of the security with the same qty
+   struct QtyLevel {
+      unsigned  _qty;
+      OrderList _orders;
    };
 
-   using OrderSet = std::unordered_set<OrderShared, OrderSharedHash, OrderSharedEqual>;
+   // levels of the security sorted by qty - orders with qty >= minQty are the tail levels
+   using QtyIndex = std::vector<QtyLevel>;
+
+   static QtyIndex::iterator findLevel(QtyIndex& index, unsigned qty); // the first level with qty >= given
 
    struct User {
-      StrShared _comp;
-      OrderSet  _orders;
+      Id        _comp = SymbolTable::none;
+      OrderList _orders;
+      SideQty   _qty;
    };
 
-   using StrUserMap = std::unordered_map<StrShared, User, StrSharedHash, StrSharedEqual>;
+   using CompSlots = HashMap<Id, std::uint32_t>;
+   using QtyArray = std::vector<unsigned long long>;
+
+   // security entry keeps aggregates updated by addOrder()/cancelOrder(),
+   // so getMatchingSizeForSecurity() doesn't have to walk the orders.
+   // Quantities of the active companies are kept in separate contiguous arrays per side,
+   // matchingSize() scans them without any hash lookup
+   struct Security {
+      explicit Security(NodePool* pool) : _slots(pool) {}
+
+      QtyIndex        _byQty;
+      CompSlots       _slots; // company -> its index in the arrays below
+      std::vector<Id> _comps;
+      QtyArray        _buy;
+      QtyArray        _sell;
+      SideQty         _total;
+      bool            _dirty = false; // it's in m_dirty
+      unsigned        _matching = 0;  // the last published matching size
+
+      // the side is resolved once, the rest is compiled for each of them
+      void add(Id comp, bool side, unsigned qty) { side ? add<true>(comp, qty) : add<false>(comp, qty); }
+      void remove(Id comp, bool side, unsigned qty) { side ? remove<true>(comp, qty) : remove<false>(comp, qty); }
+      unsigned matchingSize() const;
+
+      template <bool Buy> void add(Id comp, unsigned qty);
+      template <bool Buy> void remove(Id comp, unsigned qty);
+      template <bool Buy> QtyArray& sideQty() { if constexpr (Buy) return _buy; else return _sell; }
+      template <bool Buy> unsigned long long& sideTotal() { if constexpr (Buy) return _total._buy; else return _total._sell; }
+   };
 
-   using SecOrdersMap = std::unordered_map<StrShared, OrderSet, StrSharedHash, StrSharedEqual>;
+   // grows the vector indexed by the symbol id, if needed
+   template <class T>
+   T& slot(std::vector<T>& v, Id id) {
+      while (v.size() <= id) {
+         if constexpr (std::is_constructible_v<T, NodePool*>)
+            v.emplace_back(&m_pool);
+         else
+            v.emplace_back();
+      }
+      return v[id];
+   }
 
-   StrOrderMap    m_orders;
-   StrSharedSet   m_companies;
-   StrUserMap     m_users;
-   SecOrdersMap   m_securs;
+   OrderDirectory* m_dir;
+   OrderJournal*   m_journal = nullptr;
 
-   // naive multithread impl - for a moment let's just use common locks
-   using Lock = std::shared_mutex;
-   using GuardWrite = std::unique_lock<Lock>;
-   using GuardRead = std::shared_lock<Lock>;
+   // index nodes are recycled through the pool, it has to outlive the containers
+   NodePool       m_pool;
+
+   SymbolTable    m_orderIds{&m_pool};
+   SymbolTable    m_userIds{&m_pool};
+   SymbolTable    m_compIds{&m_pool};
+   SymbolTable    m_secIds{&m_pool};
+
+   std::vector<OrderImpl> m_orders;
+   std::vector<User>      m_users;
+   std::vector<Security>  m_securs;
+   std::vector<SideQty>   m_compQty; // indexed by the company id
+   std::atomic<std::size_t> m_size{0}; // live orders, changed under the write lock
+
+   // matching sizes for the lock-free readers, security ids are the same as in m_secIds
+   MatchingTable   m_matching;
+   std::vector<Id> m_dirty;
 
    mutable Lock m_lock;
 
-   // structures just for getMatchingSizeForSecurity()
-   struct CompQty {
-      StrShared _comp;
-      unsigned _qty;
+   // number of alive snapshots, while there are any, cancelled order ids are not recycled
+   mutable std::atomic<unsigned> m_pins{0};
+   std::vector<Id> m_retired;
+
+   // snapshot copy in progress: slots below _next are copied, the writer keeps the entries
+   // of the slots from _next to _end, which it changes first time, in _before
+   struct SnapshotCopy {
+      explicit SnapshotCopy(Id end) : _end(end) {}
+
+      Id _end;
+      Id _next = 0;
+      FlatHashMap<Id, OrderSnapshot::Entry> _before;
    };
-   using CompQtyList = std::list<CompQty>;
 
-};
\ No newline at end of file
+   static constexpr Id snapshotChunk = 4096; // slots copied under single read lock
+
+   // the copier changes its copy under the read lock, the writers - under the write lock.
+   // The list itself is changed by the readers, so they take m_copiesLock for it
+   mutable std::vector<SnapshotCopy*> m_copies;
+   mutable std::mutex m_copiesLock;
+
+   OrderNotifier m_notifier;
+
+   STATS_NO_UNIQUE_ADDRESS mutable OrderCacheStats m_stats;
+
+};
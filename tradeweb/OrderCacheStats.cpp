@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <bit>
+
+#include "OrderCacheStats.h"
+
+// values below subBuckets have own buckets, then every power of 2 is split into subBuckets
+unsigned LatencyHistogram::bucketOf(std::uint64_t ns) {
+   if (ns < subBuckets)
+      return static_cast<unsigned>(ns);
+   unsigned bits = static_cast<unsigned>(std::bit_width(ns)) - 1; // >= subBits
+   if (bits >= maxBits)
+      return buckets - 1;
+   unsigned sub = static_cast<unsigned>(ns >> (bits - subBits)) & (subBuckets - 1);
+   return (bits - subBits + 1) * subBuckets + sub;
+}
+
+//
+std::uint64_t LatencyHistogram::bucketTop(unsigned bucket) {
+   if (bucket < subBuckets)
+      return bucket;
+   unsigned bits = bucket / subBuckets + subBits - 1;
+   std::uint64_t sub = bucket % subBuckets;
+   std::uint64_t step = std::uint64_t(1) << (bits - subBits);
+   return ((subBuckets + sub) << (bits - subBits)) + step - 1;
+}
+
+//
+void LatencyHistogram::record(std::uint64_t ns) {
+   m_buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+   m_count.fetch_add(1, std::memory_order_relaxed);
+   m_sum.fetch_add(ns, std::memory_order_relaxed);
+   std::uint64_t max = m_max.load(std::memory_order_relaxed);
+   while (max < ns && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+      ;
+}
+
+//
+double LatencyHistogram::mean() const {
+   std::uint64_t n = count();
+   return n ? double(m_sum.load(std::memory_order_relaxed)) / double(n) : 0.0;
+}
+
+// the counts may go on while it's read - it's the estimate anyway
+std::uint64_t LatencyHistogram::percentile(double p) const {
+   std::uint64_t n = count();
+   if (!n)
+      return 0;
+   std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(p / 100.0 * double(n) + 0.5));
+   std::uint64_t seen = 0;
+   for (unsigned b = 0; b < buckets; b++) {
+      seen += m_buckets[b].load(std::memory_order_relaxed);
+      if (seen >= rank)
+         return std::min(bucketTop(b), max());
+   }
+   return max();
+}
+
+//
+void LatencyHistogram::print(std::ostream& out) const {
+   out << count() << " calls, mean " << static_cast<std::uint64_t>(mean()) << " ns, p50 " << percentile(50)
+       << ", p99 " << percentile(99) << ", p99.9 " << percentile(99.9) << ", max " << max();
+}
+
+#ifdef ORDERCACHE_STATS
+
+static const char* const opNames[statOps] = {
+   "addOrder", "cancelOrder", "cancelOrdersForUser", "cancelOrdersForSecIdWithMinimumQty",
+   "getMatchingSizeForSecurity", "getAllOrders", "snapshot", "addOrders", "cancelOrders", "load",
+   "getOutstandingQty"
+};
+
+static const char* const tableNames[statTables] = { "orderIds", "userIds", "companyIds", "securityIds" };
+
+//
+void OrderCacheStats::sampleTable(StatTable table, std::size_t buckets, double loadFactor, std::size_t rehashes) {
+   Table& t = m_tables[table];
+   t._buckets.store(buckets, std::memory_order_relaxed);
+   t._loadFactor.store(loadFactor, std::memory_order_relaxed);
+   t._rehashes.store(rehashes, std::memory_order_relaxed);
+}
+
+// operations without calls are skipped. The fields of the table may come from different writes
+void OrderCacheStats::print(std::ostream& out) const {
+   out << "operations:\n";
+   for (unsigned op = 0; op < statOps; op++) {
+      if (!m_ops[op].count())
+         continue;
+      out << "  " << opNames[op] << ": ";
+      m_ops[op].print(out);
+      out << '\n';
+   }
+   out << "symbol tables (as of the last write):\n";
+   for (unsigned t = 0; t < statTables; t++) {
+      const Table& table = m_tables[t];
+      out << "  " << tableNames[t] << ": " << table._buckets.load(std::memory_order_relaxed) << " buckets, load factor "
+          << table._loadFactor.load(std::memory_order_relaxed) << ", rehashes "
+          << table._rehashes.load(std::memory_order_relaxed) << '\n';
+   }
+}
+
+//
+void LockStats::print(std::ostream& out) const {
+   const LatencyHistogram* hists[] = {&_writeWait, &_writeHold, &_readWait, &_readHold};
+   const char* names[] = {"write wait", "write hold", "read wait", "read hold"};
+   out << "lock:\n";
+   for (unsigned i = 0; i < 4; i++) {
+      out << "  " << names[i] << ": ";
+      hists[i]->print(out);
+      out << '\n';
+   }
+}
+
+#else
+
+//
+void OrderCacheStats::print(std::ostream& out) const {
+   out << "statistics are compiled out, build with ORDERCACHE_STATS\n";
+}
+
+#endif
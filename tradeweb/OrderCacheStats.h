@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Optional instrumentation of OrderCacheImpl, compiled in with ORDERCACHE_STATS:
+//   - number of calls and latency histogram of every operation;
+//   - wait and hold times of the cache lock, separately for the writers and the readers;
+//   - load factors and rehashes of the symbol tables.
+// Without it OpTimer does nothing, the lock is plain std::shared_mutex and OrderCacheStats
+// has no members, so the operations are exactly the same as without the instrumentation.
+// OrderCacheImpl::dumpStats() prints them as text
+enum StatOp : unsigned {
+   statAddOrder, statCancelOrder, statCancelUser, statCancelSecMinQty, statMatching, statAllOrders,
+   statSnapshot, statAddBatch, statCancelBatch, statLoad, statOutstanding, statOps
+};
+
+// symbol tables of the cache, which rehashes are counted
+enum StatTable : unsigned { tableOrders, tableUsers, tableCompanies, tableSecurities, statTables };
+
+// HDR-style histogram of nanoseconds: 16 linear sub-buckets per power of 2, so every value
+// is kept with the error below 1/16 of it. Recording is a few relaxed atomic operations
+class LatencyHistogram {
+public:
+   void record(std::uint64_t ns);
+
+   std::uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+   std::uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+   double mean() const;
+
+   // upper bound of the bucket, which has the percentile p (0..100)
+   std::uint64_t percentile(double p) const;
+
+   // "count, mean, p50, p99, p99.9, max" in ns
+   void print(std::ostream& out) const;
+
+private:
+   static constexpr unsigned subBits = 4;
+   static constexpr unsigned subBuckets = 1u << subBits;
+   static constexpr unsigned maxBits = 40; // ~18 minutes, longer ones go to the last bucket
+   static constexpr unsigned buckets = (maxBits - subBits + 1) * subBuckets;
+
+   static unsigned bucketOf(std::uint64_t ns);
+   static std::uint64_t bucketTop(unsigned bucket);
+
+   std::atomic<std::uint64_t> m_buckets[buckets] = {};
+   std::atomic<std::uint64_t> m_count{0};
+   std::atomic<std::uint64_t> m_sum{0};
+   std::atomic<std::uint64_t> m_max{0};
+};
+
+//
+inline std::uint64_t statNow() {
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// for the member of OrderCacheStats, which is empty without ORDERCACHE_STATS and takes no space
+// then. MSVC accepts the standard attribute, but ignores it - it has own one
+#if defined(_MSC_VER) && !defined(__clang__)
+#define STATS_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define STATS_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+#ifdef ORDERCACHE_STATS
+
+// statistics of the operations and the symbol tables of single cache
+class OrderCacheStats {
+public:
+   static constexpr bool enabled = true;
+
+   LatencyHistogram& op(StatOp op) { return m_ops[op]; }
+
+   // called by the writers, rehashes - the count the table keeps
+   void sampleTable(StatTable table, std::size_t buckets, double loadFactor, std::size_t rehashes);
+
+   void print(std::ostream& out) const;
+
+private:
+   // written by the writers under the cache lock, print() reads them without it
+   struct Table {
+      std::atomic<std::size_t> _buckets{0};
+      std::atomic<std::size_t> _rehashes{0};
+      std::atomic<double>      _loadFactor{0};
+   };
+
+   LatencyHistogram m_ops[statOps];
+   Table            m_tables[statTables];
+};
+
+// measures the operation from the construction till the end of the scope
+class OpTimer {
+public:
+   OpTimer(OrderCacheStats& stats, StatOp op) : m_hist(stats.op(op)), m_start(statNow()) {}
+   ~OpTimer() { m_hist.record(statNow() - m_start); }
+
+   OpTimer(const OpTimer&) = delete;
+   OpTimer& operator=(const OpTimer&) = delete;
+
+private:
+   LatencyHistogram& m_hist;
+   std::uint64_t m_start;
+};
+
+// wait and hold times of the lock
+struct LockStats {
+   LatencyHistogram _writeWait;
+   LatencyHistogram _writeHold;
+   LatencyHistogram _readWait;
+   LatencyHistogram _readHold;
+
+   void print(std::ostream& out) const;
+};
+
+// shared mutex, which measures the times of its holders. The thread keeps the read locks it holds
+// in thread local list - the lock with the time it has got it, so the thread may hold the read
+// locks of several caches at once
+template <class Mutex>
+class StatLock {
+public:
+   void lock() {
+      std::uint64_t start = statNow();
+      m_mutex.lock();
+      m_locked = statNow();
+      m_stats._writeWait.record(m_locked - start);
+   }
+
+   void unlock() {
+      m_stats._writeHold.record(statNow() - m_locked);
+      m_mutex.unlock();
+   }
+
+   void lock_shared() {
+      std::uint64_t start = statNow();
+      m_mutex.lock_shared();
+      std::uint64_t locked = statNow();
+      readLocks().emplace_back(this, locked);
+      m_stats._readWait.record(locked - start);
+   }
+
+   void unlock_shared() {
+      std::uint64_t now = statNow();
+      auto& held = readLocks();
+      for (auto it = held.rbegin(); held.rend() != it; ++it) {
+         if (this == it->first) {
+            m_stats._readHold.record(now - it->second);
+            held.erase(std::next(it).base());
+            break;
+         }
+      }
+      m_mutex.unlock_shared();
+   }
+
+   const LockStats& stats() const { return m_stats; }
+
+private:
+   // the last one is the latest, the capacity is kept, so it doesn't allocate after the first locks
+   static std::vector<std::pair<const StatLock*, std::uint64_t>>& readLocks() {
+      thread_local std::vector<std::pair<const StatLock*, std::uint64_t>> held;
+      return held;
+   }
+
+   Mutex m_mutex;
+   std::uint64_t m_locked = 0; // the writer has got it
+   LockStats m_stats;
+};
+
+#else
+
+//
+class OrderCacheStats {
+public:
+   static constexpr bool enabled = false;
+
+   void sampleTable(StatTable, std::size_t, double, std::size_t) {}
+   void print(std::ostream& out) const;
+};
+
+//
+class OpTimer {
+public:
+   OpTimer(OrderCacheStats&, StatOp) {}
+};
+
+#endif
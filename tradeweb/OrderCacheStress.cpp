@@ -0,0 +1,673 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <latch>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "OrderCacheStress.h"
+#include "OrderCacheWorkload.h"
+#include "OrderCacheImpl.h"
+#include "ShardedOrderCacheImpl.h"
+
+using std::cout; using std::cerr; using std::endl;
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::steady_clock;
+using SideQty = OrderCacheImpl::SideQty;
+
+namespace {
+
+// operations of the writers and of the readers
+enum WriteKind : unsigned { wrAdd, wrCancel, wrCancelUser, wrCancelSec, wrKinds };
+enum ReadKind : unsigned { rdMatch, rdOutstanding, rdSnapshot, rdKinds };
+
+const char* const writeNames[wrKinds] = {"addOrder", "cancelOrder", "cancelOrdersForUser",
+                                         "cancelOrdersForSecIdWithMinimumQty"};
+const char* const readNames[rdKinds] = {"matchingSize", "getOutstandingQtyForUser", "snapshot"};
+
+// stress settings, "tradeweb stress key=value ...", see usage()
+struct Config : WorkloadConfig {
+   Config() : WorkloadConfig(100000, 50, 200, 10, 1000, {60, 35, 1, 4}) {}
+
+   unsigned _writers = 4;
+   unsigned _readers = 2;
+   unsigned _snapshotEvery = 1000; // every N-th read of the reader is the snapshot
+   std::size_t _phase = 10000;     // operations per writer between the checks
+   bool _check = true;             // the model, without it - just the throughput
+};
+
+//
+void usage() {
+   cerr << "usage: tradeweb stress [key=value ...]\n"
+           "  writers=N readers=N  number of threads (4, 2), secs > writers, users >= writers\n"
+           "  snapshot=N      every N-th read is the snapshot (1000)\n"
+           "  check=0|1       check against the model (1)\n"
+           "  phase=N         operations per writer between the checks (10000)\n";
+   workloadUsage(cerr, Config(), "operations per writer", "add,cancel,cancelUser,cancelSec");
+}
+
+// false - unknown or malformed argument
+bool parseArgs(int argc, char* argv[], Config& cfg) {
+   auto stressArg = [&cfg](const string& key, const string& value) {
+      if ("writers" == key) cfg._writers = std::stoul(value);
+      else if ("readers" == key) cfg._readers = std::stoul(value);
+      else if ("snapshot" == key) cfg._snapshotEvery = std::stoul(value);
+      else if ("phase" == key) cfg._phase = std::stoul(value);
+      else if ("check" == key) cfg._check = ("0" != value);
+      else
+         return false;
+      return true;
+   };
+   if (!parseWorkloadArgs(argc, argv, cfg, stressArg))
+      return false;
+   // every writer has own users and securities, see makeWrites()
+   return cfg._writers && cfg._secs > cfg._writers && cfg._users >= cfg._writers && cfg._snapshotEvery && cfg._phase;
+}
+
+// counts the errors of the stress, the first ones are printed
+class Errors {
+public:
+   void error(const string& what) {
+      if (m_count.fetch_add(1) < 10)
+         cerr << "stress error: " << what << endl;
+   }
+
+   std::size_t count() const { return m_count.load(); }
+
+private:
+   std::atomic<std::size_t> m_count{0};
+};
+
+// live order of the models
+struct ModelOrder {
+   string   _sec;
+   string   _user;
+   string   _comp;
+   unsigned _qty;
+   bool     _side;
+};
+
+// single write of the writer, _arg is the order, user or security index
+struct WriteOp {
+   WriteKind _kind;
+   unsigned  _arg;
+   unsigned  _qty; // minQty of wrCancelSec
+};
+
+// pregenerated writes of one writer, order ids are unique across the writers
+struct Writes {
+   vector<Order> _orders;
+   vector<WriteOp> _ops;
+};
+
+// The writers use the users and the securities so, that their writes commute:
+//   - every writer has own users, so cancelOrdersForUser() cancels just its orders;
+//   - the security s belongs to the writer s % (writers + 1), the remainder of writers means
+//     it's shared. The writer adds the orders to its own and to the shared securities,
+//     but cancels by min qty on its own ones only;
+//   - order ids are unique per writer, cancelOrder() takes them from the writer's own orders.
+// So the state of the cache after the writes doesn't depend on how they interleave - it's the
+// one after the operations of all the writers applied one writer after another
+Writes makeWrites(const Workload& load, const Config& cfg, unsigned writer) {
+   Writes w;
+   std::mt19937 rnd = load.random(writer);
+   std::discrete_distribution<unsigned> mix = load.mix();
+   string prefix = "W" + std::to_string(writer) + "Ord";
+   vector<unsigned> users, secs, ownSecs; // parseArgs() makes sure every writer has some
+   for (unsigned u = writer; u < cfg._users; u += cfg._writers)
+      users.push_back(u);
+   for (unsigned s = 0; s < cfg._secs; s++) {
+      unsigned owner = s % (cfg._writers + 1);
+      if (writer == owner)
+         ownSecs.push_back(s);
+      if (writer == owner || cfg._writers == owner)
+         secs.push_back(s);
+   }
+   w._ops.reserve(cfg._ops);
+   for (std::size_t i = 0; i < cfg._ops; i++) {
+      WriteOp op{static_cast<WriteKind>(mix(rnd)), 0, 0};
+      switch (op._kind) {
+      case wrAdd: {
+         unsigned user = users[rnd() % users.size()];
+         unsigned sec = secs[rnd() % secs.size()];
+         bool buy = rnd() & 1;
+         op._arg = static_cast<unsigned>(w._orders.size());
+         w._orders.push_back(load.order(prefix + std::to_string(i), sec, user, load.qty(rnd), buy));
+         break;
+      }
+      case wrCancel:
+         if (w._orders.empty())
+            continue;
+         op._arg = rnd() % w._orders.size();
+         break;
+      case wrCancelUser:
+         op._arg = users[rnd() % users.size()];
+         break;
+      default:
+         op._arg = ownSecs[rnd() % ownSecs.size()];
+         op._qty = cfg._maxQty - rnd() % (cfg._maxQty / 4 + 1); // the top quarter of qty
+      }
+      w._ops.push_back(op);
+   }
+   return w;
+}
+
+// The max flow from the buy qty of every company to the sell qty of the other companies.
+// The orders of one company are interchangeable, so it's the max matching of the orders,
+// counted without the formula of the cache
+unsigned long long maxMatching(const vector<SideQty>& comps) {
+   const unsigned long long unlimited = ~0ull;
+   std::size_t n = comps.size(), nodes = 2 * n + 2, source = 2 * n, sink = 2 * n + 1;
+   vector<vector<unsigned long long>> cap(nodes, vector<unsigned long long>(nodes, 0));
+   for (std::size_t i = 0; i < n; i++) {
+      cap[source][i] = comps[i]._buy;
+      cap[n + i][sink] = comps[i]._sell;
+      for (std::size_t j = 0; j < n; j++) {
+         if (i != j)
+            cap[i][n + j] = unlimited;
+      }
+   }
+   unsigned long long flow = 0;
+   vector<std::size_t> prev(nodes), queue;
+   for (;;) { // the shortest augmenting path (Edmonds-Karp)
+      std::fill(prev.begin(), prev.end(), nodes);
+      prev[source] = source;
+      queue.assign(1, source);
+      for (std::size_t q = 0; q < queue.size() && nodes == prev[sink]; q++) {
+         for (std::size_t v = 0; v < nodes; v++) {
+            if (cap[queue[q]][v] && nodes == prev[v]) {
+               prev[v] = queue[q];
+               queue.push_back(v);
+            }
+         }
+      }
+      if (nodes == prev[sink])
+         return flow;
+      unsigned long long push = unlimited;
+      for (std::size_t v = sink; source != v; v = prev[v])
+         push = std::min(push, cap[prev[v]][v]);
+      for (std::size_t v = sink; source != v; v = prev[v]) {
+         cap[prev[v]][v] -= push;
+         cap[v][prev[v]] += push;
+      }
+      flow += push;
+   }
+}
+
+// Single threaded model of the cache, it gets the same operations as the writers (see Workload).
+// It keeps the orders by user and by security, not the sums of the cache, and the matching
+// size is maxMatching() of the companies, for the securities with up to flowComps of them
+class Model {
+public:
+   static const std::size_t flowComps = 32;
+
+   explicit Model(Errors& errors) : m_errors(errors) {}
+
+   // the operations [begin, end) of the writer
+   void apply(const Workload& load, const Writes& w, std::size_t begin, std::size_t end);
+
+   // the cache has to be in the state of the model, the writers are waiting
+   template <class Cache>
+   void verify(Cache& cache, const string& when);
+
+   const std::map<string, ModelOrder>& orders() const { return m_orders; }
+
+   // of the last verify(), the securities with too many companies are skipped
+   const std::map<string, unsigned>& matching() const { return m_matching; }
+   std::size_t skipped() const { return m_skipped; }
+
+private:
+   void add(const Order& order);
+   void cancel(const string& orderId);
+
+   Errors& m_errors;
+   std::map<string, ModelOrder> m_orders;
+   std::map<string, string> m_userComps; // the company of the first order of the user
+   std::map<string, std::set<string>> m_userOrders;
+   std::map<string, std::set<std::pair<unsigned, string>>> m_secOrders; // qty and order id
+   std::map<string, unsigned> m_matching;
+   std::size_t m_skipped = 0;
+};
+
+//
+void Model::add(const Order& order) {
+   if (m_orders.count(order.orderId()))
+      return;
+   const string& comp = m_userComps.emplace(order.user(), order.company()).first->second;
+   m_orders[order.orderId()] = ModelOrder{order.securityId(), order.user(), comp, order.qty(), "Buy" == order.side()};
+   m_userOrders[order.user()].insert(order.orderId());
+   m_secOrders[order.securityId()].emplace(order.qty(), order.orderId());
+}
+
+//
+void Model::cancel(const string& orderId) {
+   auto found = m_orders.find(orderId);
+   if (m_orders.end() == found)
+      return;
+   m_userOrders[found->second._user].erase(orderId);
+   m_secOrders[found->second._sec].erase({found->second._qty, orderId});
+   m_orders.erase(found);
+}
+
+//
+void Model::apply(const Workload& load, const Writes& w, std::size_t begin, std::size_t end) {
+   for (std::size_t i = begin; i < end; i++) {
+      const WriteOp& op = w._ops[i];
+      switch (op._kind) {
+      case wrAdd:
+         add(w._orders[op._arg]);
+         break;
+      case wrCancel:
+         cancel(w._orders[op._arg].orderId());
+         break;
+      case wrCancelUser: {
+         std::set<string> ids = m_userOrders[load.user(op._arg)];
+         for (auto& id : ids)
+            cancel(id);
+         break;
+      }
+      default: {
+         auto& byQty = m_secOrders[load.sec(op._arg)];
+         vector<string> ids;
+         for (auto it = byQty.lower_bound({op._qty, string()}); byQty.end() != it; ++it)
+            ids.push_back(it->second);
+         for (auto& id : ids)
+            cancel(id);
+      }
+      }
+   }
+}
+
+//
+template <class Cache>
+void Model::verify(Cache& cache, const string& when) {
+   vector<Order> all = cache.getAllOrders();
+   std::sort(all.begin(), all.end(), [](const Order& a, const Order& b) { return a.orderId() < b.orderId(); });
+   if (all.size() != m_orders.size())
+      m_errors.error("cache has " + std::to_string(all.size()) + " orders, the model has " + std::to_string(m_orders.size()) + when);
+   auto model = m_orders.begin();
+   for (const Order& o : all) {
+      if (m_orders.end() == model)
+         break;
+      const ModelOrder& mo = model->second;
+      if (model->first != o.orderId() || mo._sec != o.securityId() || mo._user != o.user() || mo._comp != o.company() ||
+          mo._qty != o.qty() || mo._side != ("Buy" == o.side())) {
+         m_errors.error("order " + o.orderId() + " of the cache differs from the model" + when);
+         break;
+      }
+      ++model;
+   }
+
+   std::map<string, SideQty> users, comps;
+   m_matching.clear();
+   for (auto& [name, byQty] : m_secOrders) {
+      std::map<string, SideQty> secComps;
+      for (auto& [qty, id] : byQty) {
+         const ModelOrder& o = m_orders.at(id);
+         secComps[o._comp].add(o._side, o._qty);
+      }
+      if (secComps.size() > flowComps) {
+         m_skipped++;
+         continue;
+      }
+      vector<SideQty> flows;
+      for (auto& [comp, q] : secComps)
+         flows.push_back(q);
+      unsigned matching = static_cast<unsigned>(maxMatching(flows));
+      m_matching[name] = matching;
+      if (cache.matchingSize(name) != matching)
+         m_errors.error("matching size of " + name + " is " + std::to_string(cache.matchingSize(name)) + ", the max flow is " +
+                        std::to_string(matching) + when);
+   }
+
+   for (auto& [user, comp] : m_userComps) {
+      users[user];
+      comps[comp];
+   }
+   for (auto& [id, o] : m_orders) {
+      users[o._user].add(o._side, o._qty);
+      comps[o._comp].add(o._side, o._qty);
+   }
+   for (auto& [name, q] : users) {
+      SideQty cq = cache.getOutstandingQtyForUser(name);
+      if (cq._buy != q._buy || cq._sell != q._sell)
+         m_errors.error("outstanding qty of user " + name + " differs from the model" + when);
+   }
+   for (auto& [name, q] : comps) {
+      SideQty cq = cache.getOutstandingQtyForCompany(name);
+      if (cq._buy != q._buy || cq._sell != q._sell)
+         m_errors.error("outstanding qty of company " + name + " differs from the model" + when);
+   }
+}
+
+// Checks the changes the cache delivers after every write:
+//   - the added orders are new, the cancelled ones are live and the same as they were added;
+//   - the batch is the effect of single operation: adds only, or single cancel, or all orders
+//     of the user, or all orders of the security from some qty up;
+//   - the matching size changes of the security follow each other - every one starts
+//     from the size the previous one has reported.
+// After every phase the orders got from the batches and the last reported matching sizes have
+// to be the ones of Model, so a missed or wrong change is found.
+// The shards deliver their batches concurrently, so with them the order of the batches is
+// checked per security only (the matching sizes), and a user cancel per shard isn't complete
+class EventLog : public OrderSubscriber {
+public:
+   EventLog(bool sharded, Errors& errors) : m_sharded(sharded), m_errors(errors) {}
+
+   virtual void onChanges(const OrderChanges& changes);
+
+   // the writers are waiting, all their batches are delivered
+   void verify(const Model& model, const string& when);
+
+   std::size_t added() const { return m_added; }
+   std::size_t cancelled() const { return m_cancelled; }
+   std::size_t batches() const { return m_batches; }
+
+private:
+   void addOrder(const OrderView& v);
+   void cancelOrder(const OrderView& v);
+   bool singleOperation(const OrderSnapshot& cancelled);
+
+   std::mutex m_lock;
+   bool m_sharded;
+   Errors& m_errors;
+   std::uint64_t m_seq = 0;
+   std::unordered_map<string, ModelOrder> m_orders;
+   std::map<string, std::multiset<unsigned>> m_secQtys;
+   std::map<string, std::size_t> m_userOrders;
+   std::map<string, unsigned> m_matching; // the last reported size of the security
+   std::size_t m_added = 0;
+   std::size_t m_cancelled = 0;
+   std::size_t m_batches = 0;
+};
+
+//
+void EventLog::addOrder(const OrderView& v) {
+   ModelOrder o{string(v.securityId()), string(v.user()), string(v.company()), v.qty(), "Buy" == v.side()};
+   if (!m_orders.emplace(string(v.orderId()), o).second) {
+      m_errors.error("order " + string(v.orderId()) + " is added twice");
+      return;
+   }
+   m_secQtys[o._sec].insert(o._qty);
+   m_userOrders[o._user]++;
+   m_added++;
+}
+
+//
+void EventLog::cancelOrder(const OrderView& v) {
+   auto found = m_orders.find(string(v.orderId()));
+   if (m_orders.end() == found) {
+      m_errors.error("cancelled order " + string(v.orderId()) + " isn't live");
+      return;
+   }
+   const ModelOrder& o = found->second;
+   if (o._sec != v.securityId() || o._user != v.user() || o._comp != v.company() || o._qty != v.qty() ||
+       o._side != ("Buy" == v.side()))
+      m_errors.error("cancelled order " + string(v.orderId()) + " differs from the added one");
+   std::multiset<unsigned>& qtys = m_secQtys[o._sec];
+   qtys.erase(qtys.find(o._qty));
+   m_userOrders[o._user]--;
+   m_orders.erase(found);
+   m_cancelled++;
+}
+
+// after the cancels are applied - nothing, what the operation had to cancel, is left
+bool EventLog::singleOperation(const OrderSnapshot& cancelled) {
+   if (cancelled.size() < 2)
+      return true; // cancelOrder() or the operation, which has found single order
+   bool oneUser = true, oneSec = true;
+   unsigned minQty = cancelled[0].qty();
+   for (std::size_t i = 1; i < cancelled.size(); i++) {
+      oneUser = oneUser && cancelled[i].user() == cancelled[0].user();
+      oneSec = oneSec && cancelled[i].securityId() == cancelled[0].securityId();
+      minQty = std::min(minQty, cancelled[i].qty());
+   }
+   if (oneUser && (m_sharded || !m_userOrders[string(cancelled[0].user())]))
+      return true;
+   if (oneSec) {
+      const std::multiset<unsigned>& qtys = m_secQtys[string(cancelled[0].securityId())];
+      return qtys.end() == qtys.lower_bound(minQty);
+   }
+   return false;
+}
+
+//
+void EventLog::onChanges(const OrderChanges& changes) {
+   std::lock_guard<std::mutex> gl(m_lock);
+   m_batches++;
+   if (!m_sharded && changes._seq != ++m_seq)
+      m_errors.error("batch " + std::to_string(changes._seq) + " is out of order");
+   if (!changes._added.empty() && !changes._cancelled.empty())
+      m_errors.error("batch " + std::to_string(changes._seq) + " has both adds and cancels");
+   changes._added.forEach([this](const OrderView& v) { addOrder(v); });
+   changes._cancelled.forEach([this](const OrderView& v) { cancelOrder(v); });
+   if (!singleOperation(changes._cancelled))
+      m_errors.error("cancels of batch " + std::to_string(changes._seq) + " aren't the effect of single operation");
+
+   std::set<string> touched;
+   changes._added.forEach([&](const OrderView& v) { touched.insert(string(v.securityId())); });
+   changes._cancelled.forEach([&](const OrderView& v) { touched.insert(string(v.securityId())); });
+   for (const MatchingChange& m : changes._matching) {
+      if (!touched.count(*m._securityId))
+         m_errors.error("matching size of untouched security " + *m._securityId + " has changed");
+      unsigned& last = m_matching[*m._securityId];
+      if (m._before != last)
+         m_errors.error("matching size of " + *m._securityId + " has changed from " + std::to_string(m._before) +
+                        ", the last change was to " + std::to_string(last));
+      last = m._after;
+   }
+}
+
+//
+void EventLog::verify(const Model& model, const string& when) {
+   std::lock_guard<std::mutex> gl(m_lock);
+   if (m_orders.size() != model.orders().size())
+      m_errors.error("the batches have " + std::to_string(m_orders.size()) + " live orders, the model has " +
+                     std::to_string(model.orders().size()) + when);
+   for (auto& [id, o] : model.orders()) {
+      if (!m_orders.count(id)) {
+         m_errors.error("the batches have missed order " + id + when);
+         break;
+      }
+   }
+   for (auto& [sec, size] : model.matching()) {
+      auto found = m_matching.find(sec);
+      unsigned reported = m_matching.end() == found ? 0 : found->second;
+      if (reported != size)
+         m_errors.error("the last reported matching size of " + sec + " is " + std::to_string(reported) +
+                        ", the max flow is " + std::to_string(size) + when);
+   }
+}
+
+// the operations [begin, end) of the writer. It stops on the first exception of the cache -
+// its indexes are broken. false - it has happened
+template <class Cache>
+bool runWriter(Cache& cache, const Workload& load, const Writes& w, std::size_t begin, std::size_t end, Errors& errors,
+               std::size_t (&counts)[wrKinds]) {
+   try {
+      for (std::size_t i = begin; i < end; i++) {
+         const WriteOp& op = w._ops[i];
+         switch (op._kind) {
+         case wrAdd:
+            cache.addOrder(w._orders[op._arg]);
+            break;
+         case wrCancel:
+            cache.cancelOrder(w._orders[op._arg].orderId());
+            break;
+         case wrCancelUser:
+            cache.cancelOrdersForUser(load.user(op._arg));
+            break;
+         default:
+            cache.cancelOrdersForSecIdWithMinimumQty(load.sec(op._arg), op._qty);
+         }
+         counts[op._kind]++;
+      }
+      return true;
+   }
+   catch (const string& e) {
+      errors.error("writer has got " + e);
+   }
+   catch (const std::exception& e) {
+      errors.error(string("writer has got ") + e.what());
+   }
+   return false;
+}
+
+// queries till the writers are done, snapshots are checked for duplicates
+template <class Cache>
+void runReader(Cache& cache, const Config& cfg, const Workload& load, unsigned reader, const std::atomic<bool>& done,
+               Errors& errors, std::size_t (&counts)[rdKinds]) {
+   std::mt19937 rnd(cfg._seed * 104729 + reader);
+   unsigned long long sum = 0;
+   for (std::size_t i = 1; !done.load(std::memory_order_relaxed); i++) {
+      if (0 == i % cfg._snapshotEvery) {
+         OrderSnapshot snap = cache.snapshot();
+         std::unordered_set<std::string_view> ids;
+         snap.forEach([&](const OrderView& v) {
+            if (!ids.insert(v.orderId()).second || !v.qty() || ("Buy" != v.side() && "Sell" != v.side()))
+               errors.error("snapshot has broken order " + string(v.orderId()));
+         });
+         counts[rdSnapshot]++;
+      }
+      else if (i & 1) {
+         sum += cache.matchingSize(load.sec(rnd() % cfg._secs));
+         counts[rdMatch]++;
+      }
+      else {
+         sum += cache.getOutstandingQtyForUser(load.user(rnd() % cfg._users))._buy;
+         counts[rdOutstanding]++;
+      }
+   }
+   querySink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+// The writers and the readers against a fresh cache, they start together. The writers go in
+// phases of cfg._phase operations each - after every phase they wait for each other, while the
+// last one applies the phase to the model and checks the cache and the batches against it.
+// The readers go on meanwhile
+template <class Cache>
+bool stressCache(const Config& cfg) {
+   Workload load(cfg);
+   vector<Writes> writes;
+   std::size_t adds = 0;
+   for (unsigned t = 0; t < cfg._writers; t++) {
+      writes.push_back(makeWrites(load, cfg, t));
+      adds += writes.back()._orders.size();
+   }
+   Cache cache;
+   Errors errors;
+   Model model(errors);
+   EventLog log("sharded" == cfg._cache, errors);
+   if (cfg._check)
+      cache.subscribe(&log);
+
+   std::size_t phaseOps = cfg._check ? cfg._phase : std::max<std::size_t>(cfg._ops, 1);
+   std::size_t phases = (cfg._ops + phaseOps - 1) / phaseOps, phase = 0;
+   double checkSeconds = 0;
+   auto checkPhase = [&]() noexcept {
+      auto begin = Clock::now();
+      if (cfg._check) {
+         for (auto& w : writes)
+            model.apply(load, w, std::min(phase * phaseOps, w._ops.size()), std::min((phase + 1) * phaseOps, w._ops.size()));
+         string when = " after phase " + std::to_string(phase + 1);
+         model.verify(cache, when);
+         log.verify(model, when);
+      }
+      phase++;
+      checkSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+   };
+   std::barrier sync(cfg._writers, checkPhase);
+
+   vector<std::array<std::size_t, wrKinds>> wrCounts(cfg._writers);
+   vector<std::array<std::size_t, rdKinds>> rdCounts(cfg._readers);
+   std::atomic<bool> done{false};
+   std::latch start(cfg._writers + cfg._readers + 1);
+   vector<std::thread> writers, readers;
+   for (unsigned t = 0; t < cfg._writers; t++) {
+      writers.emplace_back([&, t] {
+         std::size_t counts[wrKinds] = {};
+         const Writes& w = writes[t];
+         bool ok = true;
+         start.arrive_and_wait();
+         for (std::size_t p = 0; p < phases; p++) {
+            if (ok)
+               ok = runWriter(cache, load, w, std::min(p * phaseOps, w._ops.size()), std::min((p + 1) * phaseOps, w._ops.size()),
+                              errors, counts);
+            sync.arrive_and_wait();
+         }
+         std::copy(std::begin(counts), std::end(counts), wrCounts[t].begin());
+      });
+   }
+   for (unsigned t = 0; t < cfg._readers; t++) {
+      readers.emplace_back([&, t] {
+         std::size_t counts[rdKinds] = {};
+         start.arrive_and_wait();
+         runReader(cache, cfg, load, t, done, errors, counts);
+         std::copy(std::begin(counts), std::end(counts), rdCounts[t].begin());
+      });
+   }
+   start.arrive_and_wait();
+   auto begin = Clock::now();
+   for (auto& w : writers)
+      w.join();
+   double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+   done = true;
+   for (auto& r : readers)
+      r.join();
+
+   std::size_t totalWrites = 0, totalReads = 0;
+   for (unsigned op = 0; op < wrKinds; op++) {
+      std::size_t n = 0;
+      for (auto& c : wrCounts)
+         n += c[op];
+      totalWrites += n;
+      cout << "stress\t" << cfg._cache << "\t" << writeNames[op] << "\tn=" << n << endl;
+   }
+   for (unsigned op = 0; op < rdKinds; op++) {
+      std::size_t n = 0;
+      for (auto& c : rdCounts)
+         n += c[op];
+      totalReads += n;
+      cout << "stress\t" << cfg._cache << "\t" << readNames[op] << "\tn=" << n << endl;
+   }
+   // the writers don't run during the checks, the readers do
+   double writeSeconds = std::max(seconds - checkSeconds, 1e-9);
+   seconds = std::max(seconds, 1e-9);
+   cout << "stress\t" << cfg._cache << "\twriters=" << cfg._writers << "\treaders=" << cfg._readers << "\t" << writeSeconds
+        << " s\t" << totalWrites / writeSeconds << " writes/s\t" << totalReads / seconds << " reads/s" << endl;
+
+   if (cfg._check) {
+      cache.unsubscribe(&log);
+      if (adds != log.added())
+         errors.error(std::to_string(adds) + " orders were added, the cache has reported " + std::to_string(log.added()));
+      cout << "check\t" << phases << " phases, " << log.batches() << " batches, " << log.added() << " added, "
+           << log.cancelled() << " cancelled, " << model.skipped() << " matching checks skipped, " << errors.count()
+           << " errors" << endl;
+   }
+   return !errors.count();
+}
+
+} // namespace
+
+//
+int runStress(int argc, char* argv[]) {
+   Config cfg;
+   if (!parseArgs(argc, argv, cfg)) {
+      usage();
+      return 1;
+   }
+   bool ok = "sharded" == cfg._cache ? stressCache<ShardedOrderCacheImpl>(cfg) : stressCache<OrderCacheImpl>(cfg);
+   return ok ? 0 : 1;
+}
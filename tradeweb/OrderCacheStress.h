@@ -0,0 +1,10 @@
+#pragma once
+
+// concurrent stress test of the cache, started by "tradeweb stress [key=value ...]":
+// writer threads add and cancel orders, reader threads query it meanwhile. The writes of
+// the writers commute, so after every phase of them the cache has to be in the state of single
+// threaded model, which applies the same operations and counts the matching sizes by max flow.
+// The batches the cache delivers to its subscriber are checked against the model too.
+// Throughput of the writers and the readers is reported, so the locking of the caches can be
+// compared. Returns 0 - no errors found
+int runStress(int argc, char* argv[]);
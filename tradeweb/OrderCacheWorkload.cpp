@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "OrderCacheWorkload.h"
+
+using std::string;
+using std::vector;
+
+std::atomic<unsigned long long> querySink{0};
+
+//
+vector<unsigned> parseList(const string& s) {
+   vector<unsigned> values;
+   std::size_t pos = 0;
+   while (pos <= s.size()) {
+      std::size_t comma = std::min(s.find(',', pos), s.size());
+      values.push_back(static_cast<unsigned>(std::stoul(s.substr(pos, comma - pos))));
+      pos = comma + 1;
+   }
+   return values;
+}
+
+// the number of the mix weights is the one of the defaults. std::discrete_distribution
+// doesn't take all zero weights
+bool parseWorkloadArgs(int argc, char* argv[], WorkloadConfig& cfg, const DriverArg& driverArg) {
+   std::size_t mixSize = cfg._mix.size();
+   try {
+      for (int i = 2; i < argc; i++) {
+         string arg = argv[i];
+         std::size_t eq = arg.find('=');
+         string key = string::npos == eq ? string() : arg.substr(0, eq);
+         string value = string::npos == eq ? arg : arg.substr(eq + 1);
+         if ("ops" == key) cfg._ops = std::stoul(value);
+         else if ("secs" == key) cfg._secs = std::stoul(value);
+         else if ("users" == key) cfg._users = std::stoul(value);
+         else if ("comps" == key) cfg._comps = std::stoul(value);
+         else if ("maxqty" == key) cfg._maxQty = std::stoul(value);
+         else if ("qty" == key && ("uniform" == value || "skew" == value)) cfg._skewQty = ("skew" == value);
+         else if ("mix" == key) cfg._mix = parseList(value);
+         else if ("cache" == key && ("plain" == value || "sharded" == value)) cfg._cache = value;
+         else if ("seed" == key) cfg._seed = std::stoul(value);
+         else if (!driverArg(key, value))
+            return false;
+      }
+   }
+   catch (const std::exception&) {
+      return false;
+   }
+   bool anyOp = std::any_of(cfg._mix.begin(), cfg._mix.end(), [](unsigned weight) { return 0 != weight; });
+   return cfg._secs && cfg._users && cfg._comps && cfg._maxQty && mixSize == cfg._mix.size() && anyOp;
+}
+
+//
+void workloadUsage(std::ostream& out, const WorkloadConfig& defaults, const char* ops, const char* mixNames) {
+   out << "  ops=N           " << ops << " (" << defaults._ops << ")\n"
+       << "  secs=N users=N comps=N   number of securities, users, companies (" << defaults._secs << ", " << defaults._users
+       << ", " << defaults._comps << ")\n"
+       << "  qty=uniform|skew maxqty=N  qty distribution (uniform, " << defaults._maxQty << ")\n"
+       << "  mix=" << mixNames << "  weights (";
+   for (std::size_t i = 0; i < defaults._mix.size(); i++)
+      out << (i ? "," : "") << defaults._mix[i];
+   out << ")\n"
+       << "  cache=plain|sharded  OrderCacheImpl or ShardedOrderCacheImpl (plain)\n"
+       << "  seed=N\n";
+}
+
+//
+Workload::Workload(const WorkloadConfig& cfg) : m_cfg(cfg) {
+   for (unsigned i = 0; i < cfg._secs; i++)
+      m_secs.push_back("SecId" + std::to_string(i));
+   for (unsigned i = 0; i < cfg._users; i++)
+      m_users.push_back("User" + std::to_string(i));
+   for (unsigned i = 0; i < cfg._comps; i++)
+      m_comps.push_back("Comp" + std::to_string(i));
+}
+
+//
+Order Workload::order(const string& orderId, unsigned sec, unsigned user, unsigned qty, bool buy) const {
+   return Order(orderId, m_secs[sec], buy ? "Buy" : "Sell", qty, m_users[user], m_comps[user % m_cfg._comps]);
+}
+
+//
+unsigned Workload::qty(std::mt19937& rnd) const {
+   if (!m_cfg._skewQty)
+      return 1 + rnd() % m_cfg._maxQty;
+   // cube of the uniform value - the median is 1/8 of the max
+   double u = std::uniform_real_distribution<double>(0, 1)(rnd);
+   return 1 + static_cast<unsigned>(u * u * u * (m_cfg._maxQty - 1));
+}
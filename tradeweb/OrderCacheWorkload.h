@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "OrderCache.h"
+
+// Synthetic workload of the drivers, "tradeweb bench" and "tradeweb stress":
+//   - the settings both of them have, and the parsing of their key=value arguments;
+//   - the names of the securities, users and companies, the user always belongs to the same company;
+//   - qty of the orders and the mix of the operations - the weights of the driver's own operations.
+// The drivers generate their operations from it and run them their way
+
+// settings of the workload, the Config of the driver extends it with its own ones
+struct WorkloadConfig {
+   WorkloadConfig(std::size_t ops, unsigned secs, unsigned users, unsigned comps, unsigned maxQty, std::vector<unsigned> mix)
+      : _ops(ops), _secs(secs), _users(users), _comps(comps), _maxQty(maxQty), _mix(std::move(mix)) {}
+
+   std::size_t _ops;            // operations per thread
+   unsigned _secs;
+   unsigned _users;
+   unsigned _comps;
+   unsigned _maxQty;
+   bool _skewQty = false;       // true - many small orders, few large ones
+   std::vector<unsigned> _mix;  // relative weights of the operations, their number is fixed by the driver
+   std::string _cache = "plain"; // plain, sharded
+   unsigned _seed = 1;
+};
+
+// results of the queries of the drivers go here, so the compiler can't drop them
+extern std::atomic<unsigned long long> querySink;
+
+// "1,4,16" - the values
+std::vector<unsigned> parseList(const std::string& s);
+
+// the own argument of the driver, false - it's unknown. The argument without '=' comes with the empty key
+using DriverArg = std::function<bool(const std::string& key, const std::string& value)>;
+
+// argv[2] ... into cfg, the keys of WorkloadConfig are parsed here, the rest goes to driverArg.
+// false - unknown or malformed argument, or the mix without any operation
+bool parseWorkloadArgs(int argc, char* argv[], WorkloadConfig& cfg, const DriverArg& driverArg);
+
+// usage lines of the WorkloadConfig keys with the defaults. ops - the meaning of ops=N of the driver,
+// mixNames - "add,cancel,..." of the driver
+void workloadUsage(std::ostream& out, const WorkloadConfig& defaults, const char* ops, const char* mixNames);
+
+//
+class Workload {
+public:
+   explicit Workload(const WorkloadConfig& cfg);
+
+   const WorkloadConfig& config() const { return m_cfg; }
+   const std::string& sec(unsigned i) const { return m_secs[i]; }
+   const std::string& user(unsigned i) const { return m_users[i]; }
+
+   // the user belongs to the company user % comps
+   Order order(const std::string& orderId, unsigned sec, unsigned user, unsigned qty, bool buy) const;
+
+   // uniform or skewed, see WorkloadConfig
+   unsigned qty(std::mt19937& rnd) const;
+
+   // generator of the thread, the sequences of the threads differ, but repeat with the seed
+   std::mt19937 random(unsigned thread) const { return std::mt19937(m_cfg._seed * 7919 + thread); }
+
+   // picks the index of the operation by the weights
+   std::discrete_distribution<unsigned> mix() const { return {m_cfg._mix.begin(), m_cfg._mix.end()}; }
+
+private:
+   const WorkloadConfig& m_cfg;
+   std::vector<std::string> m_secs;
+   std::vector<std::string> m_users;
+   std::vector<std::string> m_comps;
+};
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "OrderEvents.h"
+
+//
+void OrderNotifier::subscribe(OrderSubscriber* subscriber, unsigned events) {
+   std::unique_lock<std::mutex> gl(m_lock);
+   remove(subscriber);
+   m_subscribers.push_back({subscriber, events & eventAll});
+   m_mask.fetch_or(events & eventAll, std::memory_order_relaxed);
+}
+
+// the pending changes of the kinds, which nobody wants anymore, are still delivered
+void OrderNotifier::unsubscribe(OrderSubscriber* subscriber) {
+   std::unique_lock<std::mutex> gl(m_lock);
+   remove(subscriber);
+   m_turn.wait(gl, [this] { return !m_delivering; });
+}
+
+//
+void OrderNotifier::remove(OrderSubscriber* subscriber) {
+   std::erase_if(m_subscribers, [subscriber](const Subscription& s) { return s._subscriber == subscriber; });
+   unsigned mask = 0;
+   for (const Subscription& s : m_subscribers)
+      mask |= s._events;
+   m_mask.store(mask, std::memory_order_relaxed);
+}
+
+//
+void OrderNotifier::added(const OrderSnapshot::Entry& order, std::atomic<unsigned>& pins) {
+   pin(pins);
+   m_pending._added.add(order);
+}
+
+//
+void OrderNotifier::cancelled(const OrderSnapshot::Entry& order, std::atomic<unsigned>& pins) {
+   pin(pins);
+   m_pending._cancelled.add(order);
+}
+
+// once per batch - cancelled order ids aren't recycled till it's delivered
+void OrderNotifier::pin(std::atomic<unsigned>& pins) {
+   if (!m_pinned) {
+      m_pending._added.pin(pins);
+      m_pinned = true;
+   }
+}
+
+// the subscribers are called without the lock, so they may read the cache, meanwhile
+// the writers of the following batches wait for their turn
+void OrderNotifier::send(const OrderChanges& changes) {
+   unsigned kinds = 0;
+   if (!changes._added.empty())
+      kinds |= eventAdded;
+   if (!changes._cancelled.empty())
+      kinds |= eventCancelled;
+   if (!changes._matching.empty())
+      kinds |= eventMatching;
+   std::vector<OrderSubscriber*> targets;
+   std::unique_lock<std::mutex> gl(m_lock);
+   m_turn.wait(gl, [&] { return m_delivered + 1 == changes._seq; });
+   for (const Subscription& s : m_subscribers)
+      if (s._events & kinds)
+         targets.push_back(s._subscriber);
+   m_delivering = true;
+   gl.unlock();
+   auto done = [&] {
+      gl.lock();
+      m_delivering = false;
+      m_delivered = changes._seq;
+      m_turn.notify_all();
+   };
+   try {
+      for (OrderSubscriber* subscriber : targets)
+         subscriber->onChanges(changes);
+   }
+   catch (...) {
+      done(); // the next batches still go
+      throw;
+   }
+   done();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "OrderSnapshot.h"
+
+// kinds of the changes, the subscriber gets only the ones of its mask
+enum OrderEventKind : unsigned {
+   eventAdded     = 1,
+   eventCancelled = 2,
+   eventMatching  = 4, // matching size of the security has changed
+   eventAll       = eventAdded | eventCancelled | eventMatching
+};
+
+// matching size of the security before and after the write
+struct MatchingChange {
+   const std::string* _securityId;
+   unsigned           _before;
+   unsigned           _after;
+};
+
+// Changes made by single write operation of the cache (addOrders(), cancelOrdersForUser(), etc.).
+// The order strings are interned by the cache and pinned as in the snapshot, so they stay valid
+// while the batch is delivered, even if the orders are already cancelled by the next writer
+struct OrderChanges {
+   std::uint64_t               _seq = 0; // number of the write, which has made the changes
+   OrderSnapshot               _added;
+   OrderSnapshot               _cancelled;
+   std::vector<MatchingChange> _matching;
+
+   bool empty() const { return _added.empty() && _cancelled.empty() && _matching.empty(); }
+};
+
+//
+class OrderSubscriber {
+public:
+   virtual ~OrderSubscriber() = default;
+
+   // the batches, which have the changes of its kinds. Called after the write lock of the cache
+   // is released, in the order of the writes. It may read the cache, but must not change it -
+   // the next writer waits for the delivery
+   virtual void onChanges(const OrderChanges& changes) = 0;
+};
+
+// Collects the changes of the cache under its write lock and delivers them to the subscribers:
+//   - nothing is collected for the kinds, which nobody has subscribed to;
+//   - every batch gets its number under the write lock, the writer delivers it after the lock
+//     is released, when the previous batch is delivered. So the batches come in the order of
+//     the writes, while neither readers nor the write lock wait for the subscribers
+class OrderNotifier {
+public:
+   // not from onChanges() - unsubscribe() waits for the delivery in progress, so the subscriber
+   // can be destroyed right after it
+   void subscribe(OrderSubscriber* subscriber, unsigned events);
+   void unsubscribe(OrderSubscriber* subscriber);
+
+   bool wants(OrderEventKind kind) const { return m_mask.load(std::memory_order_relaxed) & kind; }
+
+   // the rest is called under the write lock of the cache, pins - its pin counter
+   void added(const OrderSnapshot::Entry& order, std::atomic<unsigned>& pins);
+   void cancelled(const OrderSnapshot::Entry& order, std::atomic<unsigned>& pins);
+   void matching(const std::string* securityId, unsigned before, unsigned after) {
+      m_pending._matching.push_back({securityId, before, after});
+   }
+
+   // releases the write lock of the cache and passes the collected changes to the subscribers
+   template <class Guard>
+   void deliver(Guard& writeLock) {
+      if (m_pending.empty())
+         return;
+      OrderChanges changes = std::move(m_pending);
+      changes._seq = ++m_seq;
+      m_pending = OrderChanges{};
+      m_pinned = false;
+      writeLock.unlock();
+      send(changes);
+   }
+
+private:
+   struct Subscription {
+      OrderSubscriber* _subscriber;
+      unsigned         _events;
+   };
+
+   void pin(std::atomic<unsigned>& pins);
+   void remove(OrderSubscriber* subscriber); // expects m_lock is taken
+   void send(const OrderChanges& changes);
+
+   // under the write lock of the cache
+   OrderChanges  m_pending;
+   bool          m_pinned = false;
+   std::uint64_t m_seq = 0;
+
+   // under m_lock
+   std::mutex                m_lock;
+   std::condition_variable   m_turn;
+   std::vector<Subscription> m_subscribers;
+   std::uint64_t             m_delivered = 0; // the last delivered batch
+   bool                      m_delivering = false;
+   std::atomic<unsigned>     m_mask{0}; // events of all subscribers
+};
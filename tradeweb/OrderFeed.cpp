@@ -0,0 +1,131 @@
+#include <charconv>
+#include <cstring>
+
+#include "OrderFeed.h"
+
+using namespace std::string_view_literals;
+
+// enough for ~100K orders, the block grows only for the longer line
+static const std::size_t blockSize = 4 << 20;
+
+// at most 7 tokens are needed, the rest of the line is the 8th one
+static const std::size_t maxTokens = 8;
+
+namespace {
+
+//
+bool isBlank(char c) {
+   return ' ' == c || '\t' == c || '\r' == c;
+}
+
+// splits the line in place, returns the number of the tokens
+std::size_t tokenize(std::string_view line, std::string_view* tokens) {
+   std::size_t n = 0, pos = 0;
+   while (n < maxTokens) {
+      while (pos < line.size() && isBlank(line[pos]))
+         pos++;
+      if (pos == line.size())
+         break;
+      std::size_t start = pos;
+      while (pos < line.size() && !isBlank(line[pos]))
+         pos++;
+      tokens[n++] = line.substr(start, pos - start);
+   }
+   return n;
+}
+
+// the whole token has to be the number
+bool parseUnsigned(std::string_view s, unsigned& value) {
+   auto res = std::from_chars(s.data(), s.data() + s.size(), value);
+   return std::errc() == res.ec && s.data() + s.size() == res.ptr;
+}
+
+//
+bool isSide(std::string_view s) {
+   return "Buy"sv == s || "Sell"sv == s;
+}
+
+} // namespace
+
+//
+bool OrderFeed::run(std::FILE* in) {
+   std::vector<char> block(blockSize);
+   std::size_t kept = 0; // the unterminated line of the previous block
+   while (true) {
+      std::size_t got = std::fread(block.data() + kept, 1, block.size() - kept, in);
+      if (!got) {
+         parse(std::string_view(block.data(), kept), true);
+         break;
+      }
+      std::size_t size = kept + got;
+      std::size_t used = parse(std::string_view(block.data(), size), false);
+      kept = size - used;
+      if (kept == block.size())
+         block.resize(2 * block.size()); // the line is longer than the block
+      else
+         std::memmove(block.data(), block.data() + used, kept);
+   }
+   return !std::ferror(in);
+}
+
+//
+std::size_t OrderFeed::parse(std::string_view text, bool last) {
+   std::size_t pos = 0;
+   while (pos < text.size()) {
+      const void* eol = std::memchr(text.data() + pos, '\n', text.size() - pos);
+      if (!eol && !last)
+         break;
+      std::size_t end = eol ? static_cast<const char*>(eol) - text.data() : text.size();
+      parseLine(text.substr(pos, end - pos));
+      pos = eol ? end + 1 : end;
+   }
+   m_handler.flush();
+   return pos;
+}
+
+//
+void OrderFeed::parseLine(std::string_view line) {
+   m_stats._lines++;
+   std::string_view t[maxTokens];
+   std::size_t n = tokenize(line, t);
+   if (!n || '#' == t[0].front())
+      return;
+   unsigned qty = 0;
+   bool valid = false;
+   FeedOp op = feedAdd;
+   if (7 == n && "ADD"sv == t[0]) {
+      valid = isSide(t[3]) && parseUnsigned(t[4], qty);
+      if (valid)
+         m_handler.add(OrderView(t[1], t[2], t[3], qty, t[5], t[6]));
+   }
+   else if (6 == n && isSide(t[2])) {
+      valid = parseUnsigned(t[3], qty);
+      if (valid)
+         m_handler.add(OrderView(t[0], t[1], t[2], qty, t[4], t[5]));
+   }
+   else if (2 == n && "CANCEL"sv == t[0]) {
+      op = feedCancel;
+      valid = true;
+      m_handler.cancel(t[1]);
+   }
+   else if (2 == n && "CANCEL_USER"sv == t[0]) {
+      op = feedCancelUser;
+      valid = true;
+      m_handler.cancelUser(t[1]);
+   }
+   else if (3 == n && "CANCEL_SEC_MINQTY"sv == t[0]) {
+      op = feedCancelSecMinQty;
+      valid = parseUnsigned(t[2], qty);
+      if (valid)
+         m_handler.cancelSecMinQty(t[1], qty);
+   }
+   else if (2 == n && "QUERY"sv == t[0]) {
+      op = feedQuery;
+      valid = true;
+      m_handler.query(t[1]);
+   }
+   if (valid)
+      m_stats._events[op]++;
+   else if (!m_stats._errors++)
+      m_stats._firstError = m_stats._lines;
+}
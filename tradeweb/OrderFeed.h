@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OrderSnapshot.h"
+
+// Events of the feed, one per line, tokens are separated by blanks:
+//   ADD ordId secId side qty user company
+//   CANCEL ordId
+//   CANCEL_USER user
+//   CANCEL_SEC_MINQTY secId minQty
+//   QUERY secId
+// A line of 6 tokens without the verb is ADD - the format of the original input.
+// Empty lines and lines starting with '#' are skipped
+enum FeedOp : unsigned { feedAdd, feedCancel, feedCancelUser, feedCancelSecMinQty, feedQuery, feedOps };
+
+// receiver of the parsed events, the views point into the read buffer
+class FeedHandler {
+public:
+   virtual ~FeedHandler() = default;
+
+   virtual void add(const OrderView& order) = 0;
+   virtual void cancel(std::string_view orderId) = 0;
+   virtual void cancelUser(std::string_view user) = 0;
+   virtual void cancelSecMinQty(std::string_view securityId, unsigned minQty) = 0;
+   virtual void query(std::string_view securityId) = 0;
+
+   // the views passed so far are going to be invalid - the buffer is refilled
+   virtual void flush() = 0;
+};
+
+//
+struct FeedStats {
+   std::size_t _lines = 0;
+   std::size_t _events[feedOps] = {};
+   std::size_t _errors = 0;     // malformed lines, they're skipped
+   std::size_t _firstError = 0; // its line number, 0 - none
+};
+
+// Streaming parser of the event lines:
+//   - the input is read by large blocks, the lines are tokenized in place into std::string_view,
+//     numbers are parsed by std::from_chars - nothing is allocated per line;
+//   - the events are passed to the handler, which is flushed after every block
+class OrderFeed {
+public:
+   explicit OrderFeed(FeedHandler& handler) : m_handler(handler) {}
+
+   // reads the stream till the end, false - read error
+   bool run(std::FILE* in);
+
+   // parses the complete lines of the text, the unterminated tail only if it's the last one,
+   // returns the number of the parsed bytes
+   std::size_t parse(std::string_view text, bool last);
+
+   const FeedStats& stats() const { return m_stats; }
+
+private:
+   void parseLine(std::string_view line);
+
+   FeedHandler& m_handler;
+   FeedStats m_stats;
+};
+
+// Feeds the events into the cache (OrderCacheImpl, ShardedOrderCacheImpl).
+// Consecutive adds and consecutive cancels are passed in batches, any other event flushes
+// the batch first, so the order of the events is kept. QUERY prints "secId size" to out
+template <class Cache>
+class CacheFeed : public FeedHandler {
+public:
+   CacheFeed(Cache& cache, std::ostream* out, std::size_t batch = 4096) : m_cache(cache), m_out(out), m_batch(batch) {
+      m_adds.reserve(batch);
+      m_cancels.reserve(batch);
+   }
+
+   virtual void add(const OrderView& order) {
+      flushCancels();
+      m_adds.push_back(order);
+      if (m_adds.size() >= m_batch)
+         flushAdds();
+   }
+
+   virtual void cancel(std::string_view orderId) {
+      flushAdds();
+      m_cancels.push_back(orderId);
+      if (m_cancels.size() >= m_batch)
+         flushCancels();
+   }
+
+   virtual void cancelUser(std::string_view user) {
+      flush();
+      m_str.assign(user);
+      m_cache.cancelOrdersForUser(m_str);
+   }
+
+   virtual void cancelSecMinQty(std::string_view securityId, unsigned minQty) {
+      flush();
+      m_str.assign(securityId);
+      m_cache.cancelOrdersForSecIdWithMinimumQty(m_str, minQty);
+   }
+
+   virtual void query(std::string_view securityId) {
+      flush();
+      unsigned size = m_cache.matchingSize(securityId);
+      if (m_out)
+         *m_out << securityId << ' ' << size << '\n';
+   }
+
+   virtual void flush() {
+      flushAdds();
+      flushCancels();
+   }
+
+private:
+   void flushAdds() {
+      if (!m_adds.empty()) {
+         m_cache.addOrders(m_adds);
+         m_adds.clear();
+      }
+   }
+
+   void flushCancels() {
+      if (!m_cancels.empty()) {
+         m_cache.cancelOrders(m_cancels);
+         m_cancels.clear();
+      }
+   }
+
+   Cache& m_cache;
+   std::ostream* m_out;
+   std::size_t m_batch;
+   std::vector<OrderView> m_adds;
+   std::vector<std::string_view> m_cancels;
+   std::string m_str; // argument of the rare events, which take std::string
+};
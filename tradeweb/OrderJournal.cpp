@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "OrderJournal.h"
+#include "OrderCacheImpl.h"
+#include "OrderFeed.h"
+#include "FlatHashMap.h"
+
+using namespace std::string_view_literals;
+
+// journal file buffer
+static const std::size_t journalBuffer = 1 << 20;
+
+namespace {
+
+enum RecordType : std::uint8_t { recUser, recComp, recSec, recAdd, recCancel };
+
+// fixed parts of the journal records, _len bytes of the string follow them
+struct RecSymbol {
+   std::uint8_t  _type; // recUser, recComp, recSec
+   std::uint8_t  _pad;
+   std::uint16_t _len;
+   std::uint32_t _id;
+};
+
+struct RecAdd {
+   std::uint8_t  _type;
+   std::uint8_t  _side; // 1 - "Buy"
+   std::uint16_t _len;  // of the order id
+   std::uint32_t _user;
+   std::uint32_t _comp;
+   std::uint32_t _sec;
+   std::uint32_t _qty;
+};
+
+struct RecCancel {
+   std::uint8_t  _type;
+   std::uint8_t  _pad;
+   std::uint16_t _len;
+};
+
+// snapshot file: header, orders, symbols (users, companies, securities), strings
+const char snapMagic[8] = {'O', 'C', 'S', 'N', 'A', 'P', '1', '\0'};
+
+struct SnapHeader {
+   char          _magic[8];
+   std::uint32_t _gen;
+   std::uint32_t _orders;
+   std::uint32_t _symbols[3];
+   std::uint32_t _pad;
+   std::uint64_t _strBytes;
+};
+
+// string of the strings block
+struct SnapStr {
+   std::uint32_t _off;
+   std::uint32_t _len;
+};
+
+struct SnapOrder {
+   SnapStr       _id;
+   std::uint32_t _user; // indexes of the symbols
+   std::uint32_t _comp;
+   std::uint32_t _sec;
+   std::uint32_t _qty;
+   std::uint32_t _side; // 1 - "Buy"
+};
+
+// the whole file by single read
+bool readFile(const std::string& path, std::vector<char>& data) {
+   std::FILE* f = std::fopen(path.c_str(), "rb");
+   if (!f)
+      return false;
+   std::error_code ec;
+   auto size = std::filesystem::file_size(path, ec);
+   bool ok = !ec;
+   if (ok) {
+      data.resize(static_cast<std::size_t>(size));
+      ok = data.size() == std::fread(data.data(), 1, data.size(), f);
+   }
+   std::fclose(f);
+   return ok;
+}
+
+//
+std::uint16_t recordLen(std::string_view s) {
+   return static_cast<std::uint16_t>(s.size());
+}
+
+//
+std::string_view sideName(bool buy) {
+   return buy ? "Buy"sv : "Sell"sv;
+}
+
+} // namespace
+
+//
+OrderJournal::OrderJournal(std::string base) : m_base(std::move(base)) {}
+
+//
+OrderJournal::~OrderJournal() {
+   close();
+}
+
+//
+std::string OrderJournal::journalPath(std::uint32_t gen) const {
+   return m_base + "." + std::to_string(gen) + ".jrn";
+}
+
+// the generation always starts with the new file - the torn tail of the old one stays behind.
+// The failed journal isn't opened again - the records after the lost ones would be replayed
+bool OrderJournal::open(std::uint32_t gen) {
+   if (m_failed || !close())
+      return false;
+   m_gen = gen;
+   m_file = std::fopen(journalPath(gen).c_str(), "wb");
+   if (m_file)
+      std::setvbuf(m_file, nullptr, _IOFBF, journalBuffer);
+   for (auto& defined : m_defined)
+      defined.clear();
+   return nullptr != m_file;
+}
+
+// false - the buffered records are lost
+bool OrderJournal::close() {
+   if (!m_file)
+      return true;
+   bool ok = 0 == std::fclose(m_file);
+   m_file = nullptr;
+   return ok;
+}
+
+// nothing is written after the lost records, the torn one is the last in the file
+void OrderJournal::fail() {
+   close();
+   m_failed = true;
+}
+
+//
+bool OrderJournal::flush() {
+   if (m_file && 0 != std::fflush(m_file))
+      fail();
+   return !m_failed;
+}
+
+// the string, which the record can't keep, fails the journal like the write error - the cache
+// completes the change anyway, throwing from the middle of it would leave it half done
+bool OrderJournal::fits(std::string_view s) {
+   if (s.size() > UINT16_MAX)
+      fail();
+   return !m_failed;
+}
+
+//
+void OrderJournal::write(const void* data, std::size_t size) {
+   if (m_file && size != std::fwrite(data, 1, size, m_file))
+      fail();
+}
+
+// names of the symbols are never changed by the cache, it's enough to write them once
+void OrderJournal::define(Symbol kind, Id id, std::string_view name) {
+   std::vector<bool>& defined = m_defined[kind];
+   if (id < defined.size() && defined[id])
+      return;
+   if (defined.size() <= id)
+      defined.resize(std::max<std::size_t>(id + 1, 2 * defined.size()));
+   defined[id] = true;
+   RecSymbol rec{static_cast<std::uint8_t>(unsigned(recUser) + kind), 0, recordLen(name), id};
+   write(&rec, sizeof(rec));
+   write(name.data(), name.size());
+}
+
+//
+void OrderJournal::add(const OrderView& order, Id user, Id comp, Id sec) {
+   if (!fits(order.orderId()) || !fits(order.user()) || !fits(order.company()) || !fits(order.securityId()))
+      return;
+   define(symUser, user, order.user());
+   define(symComp, comp, order.company());
+   define(symSec, sec, order.securityId());
+   RecAdd rec{recAdd, "Buy"sv == order.side(), recordLen(order.orderId()), user, comp, sec, order.qty()};
+   write(&rec, sizeof(rec));
+   write(order.orderId().data(), order.orderId().size());
+}
+
+//
+void OrderJournal::cancel(std::string_view orderId) {
+   if (!fits(orderId))
+      return;
+   RecCancel rec{recCancel, 0, recordLen(orderId)};
+   write(&rec, sizeof(rec));
+   write(orderId.data(), orderId.size());
+}
+
+//
+void OrderJournal::rotate() {
+   if (!open(m_gen + 1))
+      fail();
+}
+
+// the names of the symbols are the views of the file data
+bool OrderJournal::replay(const std::string& path, FeedHandler& handler) {
+   std::vector<char> data;
+   if (!readFile(path, data))
+      return false;
+   std::vector<std::string_view> names[symbols];
+   const char* p = data.data();
+   const char* end = p + data.size();
+   while (p < end) {
+      std::uint8_t type = static_cast<std::uint8_t>(*p);
+      if (recAdd == type) {
+         RecAdd rec;
+         if (end - p < static_cast<std::ptrdiff_t>(sizeof(rec)))
+            break; // torn record
+         std::memcpy(&rec, p, sizeof(rec));
+         if (end - p - sizeof(rec) < rec._len)
+            break;
+         std::string_view id(p + sizeof(rec), rec._len);
+         if (names[symUser].size() <= rec._user || names[symComp].size() <= rec._comp || names[symSec].size() <= rec._sec)
+            return false; // undefined symbol
+         handler.add(OrderView(id, names[symSec][rec._sec], sideName(rec._side), rec._qty, names[symUser][rec._user],
+                               names[symComp][rec._comp]));
+         p += sizeof(rec) + rec._len;
+      }
+      else if (recCancel == type) {
+         RecCancel rec;
+         if (end - p < static_cast<std::ptrdiff_t>(sizeof(rec)))
+            break;
+         std::memcpy(&rec, p, sizeof(rec));
+         if (end - p - sizeof(rec) < rec._len)
+            break;
+         handler.cancel(std::string_view(p + sizeof(rec), rec._len));
+         p += sizeof(rec) + rec._len;
+      }
+      else if (type <= recSec) {
+         RecSymbol rec;
+         if (end - p < static_cast<std::ptrdiff_t>(sizeof(rec)))
+            break;
+         std::memcpy(&rec, p, sizeof(rec));
+         if (end - p - sizeof(rec) < rec._len)
+            break;
+         std::vector<std::string_view>& table = names[type - recUser];
+         if (table.size() <= rec._id)
+            table.resize(rec._id + 1);
+         table[rec._id] = std::string_view(p + sizeof(rec), rec._len);
+         p += sizeof(rec) + rec._len;
+      }
+      else
+         return false; // corrupted
+   }
+   handler.flush();
+   return true;
+}
+
+// orders go sorted by security and qty, the symbols are numbered in the order of appearance
+bool OrderJournal::saveSnapshot(const std::string& path, const OrderSnapshot& snap, std::uint32_t gen) {
+   std::vector<SnapOrder> orders(snap.size());
+   std::vector<SnapStr> symbols[3];
+   std::string strings;
+   // the interned strings of the cache are shared, their address is the identity
+   FlatHashMap<const char*, std::uint32_t> ids[3];
+   auto str = [&strings](std::string_view s) {
+      SnapStr res{static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(s.size())};
+      strings.append(s);
+      return res;
+   };
+   auto symbol = [&](unsigned kind, std::string_view s) {
+      auto res = ids[kind].try_emplace(s.data(), static_cast<std::uint32_t>(symbols[kind].size()));
+      if (res.second)
+         symbols[kind].push_back(str(s));
+      return res.first->second;
+   };
+   for (std::size_t i = 0; i < snap.size(); i++) {
+      OrderView o = snap[i];
+      orders[i] = SnapOrder{str(o.orderId()), symbol(symUser, o.user()), symbol(symComp, o.company()),
+                            symbol(symSec, o.securityId()), o.qty(), "Buy"sv == o.side()};
+   }
+   std::sort(orders.begin(), orders.end(), [](const SnapOrder& a, const SnapOrder& b) {
+      return a._sec != b._sec ? a._sec < b._sec : a._qty < b._qty;
+   });
+
+   SnapHeader header{};
+   std::memcpy(header._magic, snapMagic, sizeof(snapMagic));
+   header._gen = gen;
+   header._orders = static_cast<std::uint32_t>(orders.size());
+   for (unsigned kind = 0; kind < 3; kind++)
+      header._symbols[kind] = static_cast<std::uint32_t>(symbols[kind].size());
+   header._strBytes = strings.size();
+
+   // the complete file replaces the old one at once
+   std::string tmp = path + ".tmp";
+   std::FILE* f = std::fopen(tmp.c_str(), "wb");
+   if (!f)
+      return false;
+   // data() of the empty vector may be null, which fwrite() doesn't take even for 0 items
+   auto put = [f](const void* data, std::size_t size, std::size_t count) {
+      return !count || count == std::fwrite(data, size, count, f);
+   };
+   bool ok = put(&header, sizeof(header), 1);
+   ok = ok && put(orders.data(), sizeof(SnapOrder), orders.size());
+   for (auto& table : symbols)
+      ok = ok && put(table.data(), sizeof(SnapStr), table.size());
+   ok = ok && put(strings.data(), 1, strings.size());
+   ok = (0 == std::fclose(f)) && ok;
+   std::error_code ec;
+   if (ok)
+      std::filesystem::rename(tmp, path, ec);
+   return ok && !ec;
+}
+
+// single read, the orders are the views of the file data, passed by single load()
+bool OrderJournal::loadSnapshot(const std::string& path, OrderCacheImpl& cache, std::uint32_t& gen, std::size_t& count) {
+   std::vector<char> data;
+   if (!readFile(path, data))
+      return false;
+   SnapHeader header;
+   if (data.size() < sizeof(header))
+      return false;
+   std::memcpy(&header, data.data(), sizeof(header));
+   if (std::memcmp(header._magic, snapMagic, sizeof(snapMagic)))
+      return false;
+   std::size_t symbolCount = std::size_t(header._symbols[0]) + header._symbols[1] + header._symbols[2];
+   std::size_t expected = sizeof(header) + std::size_t(header._orders) * sizeof(SnapOrder) + symbolCount * sizeof(SnapStr) +
+                          header._strBytes;
+   if (data.size() != expected)
+      return false;
+   // copied out of the file data - its records are not aligned. data() of the empty vector
+   // may be null, which memcpy() doesn't take even for 0 bytes
+   std::vector<SnapOrder> orders(header._orders);
+   std::vector<SnapStr> symbols(symbolCount);
+   const char* p = data.data() + sizeof(header);
+   if (!orders.empty())
+      std::memcpy(orders.data(), p, orders.size() * sizeof(SnapOrder));
+   p += orders.size() * sizeof(SnapOrder);
+   if (!symbols.empty())
+      std::memcpy(symbols.data(), p, symbols.size() * sizeof(SnapStr));
+   p += symbols.size() * sizeof(SnapStr);
+   std::string_view strings(p, static_cast<std::size_t>(header._strBytes));
+
+   auto str = [strings](const SnapStr& s) {
+      return std::size_t(s._off) + s._len <= strings.size() ? strings.substr(s._off, s._len) : std::string_view();
+   };
+   std::vector<std::string_view> names[3];
+   std::size_t first = 0;
+   for (unsigned kind = 0; kind < 3; kind++) {
+      for (std::size_t i = 0; i < header._symbols[kind]; i++)
+         names[kind].push_back(str(symbols[first + i]));
+      first += header._symbols[kind];
+   }
+   std::vector<OrderCacheImpl::LoadOrder> loads;
+   loads.reserve(orders.size());
+   for (const SnapOrder& o : orders) {
+      if (names[symUser].size() <= o._user || names[symComp].size() <= o._comp || names[symSec].size() <= o._sec)
+         return false;
+      loads.push_back({str(o._id), o._user, o._comp, o._sec, o._qty, 0 != o._side});
+   }
+   cache.load(names[symUser], names[symComp], names[symSec], loads);
+   gen = header._gen;
+   count = loads.size();
+   return true;
+}
+
+//
+bool OrderJournal::recover(OrderCacheImpl& cache) {
+   std::uint32_t gen = 0;
+   m_recovered = 0;
+   std::error_code ec;
+   if (std::filesystem::exists(snapshotPath(), ec) && !loadSnapshot(snapshotPath(), cache, gen, m_recovered))
+      return false;
+   // the journals left by the interrupted checkpoint
+   for (std::uint32_t old = gen; old-- > 0 && std::filesystem::remove(journalPath(old), ec);)
+      ;
+   CacheFeed<OrderCacheImpl> feed(cache, nullptr);
+   for (; std::filesystem::exists(journalPath(gen), ec); gen++) {
+      if (!replay(journalPath(gen), feed))
+         return false;
+   }
+   if (!open(gen))
+      return false;
+   cache.attachJournal(this);
+   return true;
+}
+
+//
+bool OrderJournal::checkpoint(OrderCacheImpl& cache) {
+   OrderSnapshot snap = cache.checkpoint();
+   if (m_failed)
+      return false; // the journals stay, the snapshot doesn't replace them
+   std::uint32_t gen = m_gen; // the new generation follows the snapshot
+   if (!saveSnapshot(snapshotPath(), snap, gen))
+      return false;
+   std::error_code ec;
+   for (std::uint32_t old = gen; old-- > 0 && std::filesystem::remove(journalPath(old), ec);)
+      ;
+   return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OrderSnapshot.h"
+
+class OrderCacheImpl;
+class FeedHandler;
+
+// Persistence of OrderCacheImpl - append-only binary journal plus compact snapshots:
+//   - files are "<base>.snap" and the journal generations "<base>.<gen>.jrn";
+//   - the cache passes every change to the journal under its write lock (attachJournal()):
+//     added order and cancelled order id, whatever API call has caused it;
+//   - records have the fixed part with interned 32-bit ids of users, companies and securities,
+//     followed by the order id string. The name of the id is written once per generation;
+//   - checkpoint() takes the snapshot and switches the journal to the next generation under
+//     single write lock, writes the snapshot (it keeps the generation, which follows it),
+//     then removes the older journals;
+//   - recover() loads the snapshot by single read and OrderCacheImpl::load(), then replays
+//     the journals of the following generations in batches. The orders of the snapshot are
+//     sorted by security and qty, so the security indexes are built by appends.
+// Both kinds of files are in the host byte order. The journal is buffered, flush() passes
+// it to the OS; the records, which weren't flushed, are lost on crash. A torn record at the end
+// of the journal is ignored.
+// The strings are limited to 64K. The first write error or the longer string fails the journal:
+// it's closed and never written again, flush() and checkpoint() return false, and every write
+// of the cache throws after it's done in memory
+class OrderJournal {
+public:
+   using Id = std::uint32_t;
+
+   explicit OrderJournal(std::string base);
+   ~OrderJournal();
+
+   OrderJournal(const OrderJournal&) = delete;
+   OrderJournal& operator=(const OrderJournal&) = delete;
+
+   // loads the empty cache from the files, starts the new journal generation and attaches
+   // the journal to the cache. false - the files are corrupted or can't be written
+   bool recover(OrderCacheImpl& cache);
+
+   // writes the snapshot of the cache, the older journals are removed. false - write error,
+   // or the next journal generation can't be started
+   bool checkpoint(OrderCacheImpl& cache);
+
+   // passes the buffered records to the OS. false - the journal has failed
+   bool flush();
+
+   // some records are lost, see above
+   bool failed() const { return m_failed; }
+
+   // orders restored by the last recover()
+   std::size_t recovered() const { return m_recovered; }
+
+   // hooks of the cache, called under its write lock. The write error fails the journal
+   void add(const OrderView& order, Id user, Id comp, Id sec);
+   void cancel(std::string_view orderId);
+   void rotate();
+
+   // the journal generation to the handler, false - the file can't be read
+   static bool replay(const std::string& path, FeedHandler& handler);
+
+   // the snapshot file into the empty cache, gen - the journal generation following it
+   static bool loadSnapshot(const std::string& path, OrderCacheImpl& cache, std::uint32_t& gen, std::size_t& orders);
+   static bool saveSnapshot(const std::string& path, const OrderSnapshot& snap, std::uint32_t gen);
+
+private:
+   enum Symbol : unsigned { symUser, symComp, symSec, symbols };
+
+   std::string journalPath(std::uint32_t gen) const;
+   std::string snapshotPath() const { return m_base + ".snap"; }
+
+   bool open(std::uint32_t gen);
+   bool close();
+   void fail();
+   bool fits(std::string_view s); // false - the journal has failed
+   void define(Symbol kind, Id id, std::string_view name);
+   void write(const void* data, std::size_t size);
+
+   std::string m_base;
+   std::FILE* m_file = nullptr;
+   std::uint32_t m_gen = 0;
+   std::vector<bool> m_defined[symbols]; // ids, which names are written to the current generation
+   std::size_t m_recovered = 0;
+   bool m_failed = false;
+};
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <iterator>
+#include <span>
+
+#include "OrderSnapshot.h"
+#include "WorkerPool.h"
+
+using namespace std::string_view_literals;
+
+static const std::string strBuy{"Buy"};
+static const std::string strSell{"Sell"};
+
+//
+OrderView OrderSnapshot::operator[](std::size_t i) const {
+   const Entry& e = m_orders[i];
+   return OrderView(*e._id, *e._sec, e._side ? "Buy"sv : "Sell"sv, e._qty, *e._user, *e._comp);
+}
+
+//
+static void appendOrders(std::vector<Order>& orders, std::span<const OrderSnapshot::Entry> entries) {
+   orders.reserve(orders.size() + entries.size());
+   for (const OrderSnapshot::Entry& e : entries)
+      orders.emplace_back(*e._id, *e._sec, e._side ? strBuy : strSell, e._qty, *e._user, *e._comp);
+}
+
+// Order has no default constructor, so the parts are filled separately and moved
+// into the result - just the string headers, the characters are copied once
+std::vector<Order> OrderSnapshot::toOrders() const {
+   std::vector<Order> orders;
+   WorkerPool& pool = WorkerPool::shared();
+   std::size_t parts = std::min<std::size_t>(pool.size(), m_orders.size() / minPartOrders);
+   if (parts < 2) {
+      appendOrders(orders, m_orders);
+      return orders;
+   }
+   std::vector<std::vector<Order>> filled(parts);
+   std::size_t step = (m_orders.size() + parts - 1) / parts;
+   pool.run(parts, [&](std::size_t part) {
+      std::size_t first = part * step;
+      appendOrders(filled[part], std::span<const Entry>(m_orders).subspan(first, std::min(step, m_orders.size() - first)));
+   });
+   orders.reserve(m_orders.size());
+   for (auto& part : filled)
+      orders.insert(orders.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+   return orders;
+}
+
+//
+void OrderSnapshot::append(OrderSnapshot&& other) {
+   if (m_orders.empty())
+      m_orders = std::move(other.m_orders);
+   else
+      m_orders.insert(m_orders.end(), other.m_orders.begin(), other.m_orders.end());
+   for (Pin& pin : other.m_pins)
+      m_pins.push_back(std::move(pin));
+   other.m_orders.clear();
+   other.m_pins.clear();
+}
+
+//
+OrderSnapshot::Pin& OrderSnapshot::Pin::operator=(Pin&& other) noexcept {
+   if (this != &other) {
+      if (m_pins)
+         m_pins->fetch_sub(1, std::memory_order_release);
+      m_pins = other.m_pins;
+      other.m_pins = nullptr;
+   }
+   return *this;
+}
+
+// release - the cache recycles the strings only after the reads of this snapshot
+OrderSnapshot::Pin::~Pin() {
+   if (m_pins)
+      m_pins->fetch_sub(1, std::memory_order_release);
+}
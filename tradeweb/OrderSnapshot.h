@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OrderCache.h"
+
+// Lightweight read-only order - the same accessors as Order, but the strings are views.
+// The snapshot gives the views of the strings interned by the cache, valid while it's alive.
+// The cache accepts them in addOrders() as well, e.g. views of the input buffer (see OrderFeed)
+class OrderView {
+public:
+   OrderView(std::string_view ordId, std::string_view secId, std::string_view side, unsigned int qty,
+             std::string_view user, std::string_view company)
+      : m_orderId(ordId), m_securityId(secId), m_side(side), m_qty(qty), m_user(user), m_company(company) { }
+
+   // views of the order strings, valid while the order is alive
+   explicit OrderView(const Order& o)
+      : OrderView(o.orderIdView(), o.securityIdView(), o.sideView(), o.qty(), o.userView(), o.companyView()) { }
+
+   std::string_view orderId() const    { return m_orderId; }
+   std::string_view securityId() const { return m_securityId; }
+   std::string_view side() const       { return m_side; }
+   std::string_view user() const       { return m_user; }
+   std::string_view company() const    { return m_company; }
+   unsigned int qty() const            { return m_qty; }
+
+private:
+   std::string_view m_orderId;
+   std::string_view m_securityId;
+   std::string_view m_side;
+   unsigned int m_qty;
+   std::string_view m_user;
+   std::string_view m_company;
+};
+
+// Orders of the cache at the moment of OrderCacheImpl::snapshot():
+//   - it copies only pointers to the interned strings under the read lock, the large cache
+//     by chunks (see OrderCacheImpl::snapshot()), all the rest (walking, conversion to Order)
+//     goes without any lock;
+//   - while it's alive, the cache defers recycling of the cancelled order ids (epoch pin),
+//     so the strings it points to stay untouched;
+//   - it must not outlive the cache it was taken from
+class OrderSnapshot {
+public:
+   OrderSnapshot() = default;
+   OrderSnapshot(OrderSnapshot&&) = default;
+   OrderSnapshot& operator=(OrderSnapshot&&) = default;
+
+   std::size_t size() const { return m_orders.size(); }
+   bool empty() const { return m_orders.empty(); }
+
+   OrderView operator[](std::size_t i) const;
+
+   template <class Visitor>
+   void forEach(Visitor&& visit) const {
+      for (std::size_t i = 0; i < m_orders.size(); i++)
+         visit((*this)[i]);
+   }
+
+   // copies the strings into the orders, large snapshots by parts on WorkerPool::shared()
+   std::vector<Order> toOrders() const;
+
+   // the rest is for the caches, which fill the snapshot
+   struct Entry {
+      const std::string* _id;
+      const std::string* _sec;
+      const std::string* _user;
+      const std::string* _comp;
+      unsigned           _qty;
+      bool               _side; // true - "Buy"
+   };
+
+   // keeps the pin counter of the cache up while alive
+   class Pin {
+   public:
+      explicit Pin(std::atomic<unsigned>& pins) : m_pins(&pins) { pins.fetch_add(1, std::memory_order_relaxed); }
+      Pin(Pin&& other) noexcept : m_pins(other.m_pins) { other.m_pins = nullptr; }
+      Pin& operator=(Pin&& other) noexcept;
+      ~Pin();
+
+   private:
+      std::atomic<unsigned>* m_pins;
+   };
+
+   void pin(std::atomic<unsigned>& pins) { m_pins.emplace_back(pins); }
+   void reserve(std::size_t orders) { m_orders.reserve(m_orders.size() + orders); }
+   void add(const Entry& entry) { m_orders.push_back(entry); }
+
+   // takes over the orders and the pins of the other snapshot
+   void append(OrderSnapshot&& other);
+
+private:
+   static constexpr std::size_t minPartOrders = 16384; // smaller parts don't pay for the threads
+
+   std::vector<Entry> m_orders;
+   std::vector<Pin> m_pins;
+};
@@ -0,0 +1,232 @@
+#include <thread>
+
+#include "ShardedOrderCacheImpl.h"
+#include "WorkerPool.h"
+
+using std::string;
+
+using GuardDir = std::lock_guard<std::mutex>;
+
+// directory has more stripes than shards - it's taken by every add/cancel
+static const unsigned dirStripesPerShard = 4;
+
+// bulk operations on fewer orders don't pay for the threads
+static const std::size_t parallelOrders = 16384;
+
+//
+ShardedOrderCacheImpl::ShardedOrderCacheImpl(unsigned shards) {
+   if (!shards)
+      shards = std::thread::hardware_concurrency();
+   if (!shards)
+      shards = 1;
+   m_hooks.reserve(shards);
+   m_shards.reserve(shards);
+   for (unsigned i = 0; i < shards; i++) {
+      m_hooks.push_back(std::make_unique<ShardDirectory>(*this, i));
+      m_shards.push_back(std::make_unique<OrderCacheImpl>(m_hooks.back().get()));
+   }
+   unsigned stripes = shards * dirStripesPerShard;
+   m_dir.reserve(stripes);
+   for (unsigned i = 0; i < stripes; i++)
+      m_dir.push_back(std::make_unique<DirStripe>());
+}
+
+//
+unsigned ShardedOrderCacheImpl::shardOf(std::string_view securityId) const {
+   return static_cast<unsigned>(StrHash{}(securityId) % m_shards.size());
+}
+
+//
+ShardedOrderCacheImpl::DirStripe& ShardedOrderCacheImpl::stripeOf(std::string_view key) {
+   return *m_dir[StrHash{}(key) % m_dir.size()];
+}
+
+//
+unsigned ShardedOrderCacheImpl::findShard(std::string_view orderId) {
+   DirStripe& ds = stripeOf(orderId);
+   GuardDir gd(ds._lock);
+   auto found = ds._shards.find(orderId);
+   return ds._shards.end() == found ? noShard : found->second;
+}
+
+// called by the shard under its write lock
+bool ShardedOrderCacheImpl::ShardDirectory::claim(std::string_view orderId) {
+   DirStripe& ds = m_owner.stripeOf(orderId);
+   GuardDir gd(ds._lock);
+   return ds._shards.emplace(orderId, m_shard).second;
+}
+
+// called by the shard under its write lock
+void ShardedOrderCacheImpl::ShardDirectory::release(std::string_view orderId) {
+   DirStripe& ds = m_owner.stripeOf(orderId);
+   GuardDir gd(ds._lock);
+   auto found = ds._shards.find(orderId);
+   if (ds._shards.end() != found && found->second == m_shard)
+      ds._shards.erase(found);
+}
+
+// called by the shard under its write lock. The names of _comps never move, so the view
+// stays valid after the stripe is unlocked
+std::string_view ShardedOrderCacheImpl::ShardDirectory::company(std::string_view user, std::string_view company) {
+   DirStripe& ds = m_owner.stripeOf(user);
+   GuardDir gd(ds._lock);
+   auto found = ds._users.find(user);
+   if (ds._users.end() == found)
+      found = ds._users.emplace(user, ds._comps.intern(company)).first;
+   return ds._comps.name(found->second);
+}
+
+//
+void ShardedOrderCacheImpl::addOrder(Order order) {
+   m_shards[shardOf(order.securityIdView())]->addOrder(std::move(order));
+}
+
+//
+void ShardedOrderCacheImpl::addOrders(std::span<const Order> orders) {
+   std::vector<std::vector<OrderView>> byShard(m_shards.size());
+   for (const Order& order : orders)
+      byShard[shardOf(order.securityIdView())].emplace_back(order);
+   for (unsigned i = 0; i < m_shards.size(); i++) {
+      if (!byShard[i].empty())
+         m_shards[i]->addOrders(byShard[i]);
+   }
+}
+
+//
+void ShardedOrderCacheImpl::addOrders(std::span<const OrderView> orders) {
+   std::vector<std::vector<OrderView>> byShard(m_shards.size());
+   for (const OrderView& order : orders)
+      byShard[shardOf(order.securityId())].push_back(order);
+   for (unsigned i = 0; i < m_shards.size(); i++) {
+      if (!byShard[i].empty())
+         m_shards[i]->addOrders(byShard[i]);
+   }
+}
+
+//
+void ShardedOrderCacheImpl::cancelOrder(const std::string& orderId) {
+   unsigned shard = findShard(orderId);
+   if (noShard != shard)
+      m_shards[shard]->cancelOrder(orderId);
+}
+
+//
+void ShardedOrderCacheImpl::cancelOrders(std::span<const std::string> orderIds) {
+   std::vector<std::vector<std::string_view>> byShard(m_shards.size());
+   for (auto& id : orderIds) {
+      unsigned shard = findShard(id);
+      if (noShard != shard)
+         byShard[shard].push_back(id);
+   }
+   forEachShard(orderIds.size() >= parallelOrders, [&](std::size_t i) {
+      if (!byShard[i].empty())
+         m_shards[i]->cancelOrders(byShard[i]);
+   });
+}
+
+//
+void ShardedOrderCacheImpl::cancelOrders(std::span<const std::string_view> orderIds) {
+   std::vector<std::vector<std::string_view>> byShard(m_shards.size());
+   for (auto id : orderIds) {
+      unsigned shard = findShard(id);
+      if (noShard != shard)
+         byShard[shard].push_back(id);
+   }
+   forEachShard(orderIds.size() >= parallelOrders, [&](std::size_t i) {
+      if (!byShard[i].empty())
+         m_shards[i]->cancelOrders(byShard[i]);
+   });
+}
+
+// remove all orders in the cache for this user - the shards of the large cache in parallel
+void ShardedOrderCacheImpl::cancelOrdersForUser(const std::string& user) {
+   forEachShard(size() >= parallelOrders, [&](std::size_t i) { m_shards[i]->cancelOrdersForUser(user); });
+}
+
+//
+void ShardedOrderCacheImpl::forEachShard(bool parallel, const std::function<void(std::size_t)>& task) {
+   if (parallel)
+      WorkerPool::shared().run(m_shards.size(), task);
+   else {
+      for (std::size_t i = 0; i < m_shards.size(); i++)
+         task(i);
+   }
+}
+
+//
+std::size_t ShardedOrderCacheImpl::size() const {
+   std::size_t orders = 0;
+   for (auto& shard : m_shards)
+      orders += shard->size();
+   return orders;
+}
+
+// remove all orders in the cache for this security with qty >= minQty
+void ShardedOrderCacheImpl::cancelOrdersForSecIdWithMinimumQty(const std::string& securityId, unsigned int minQty) {
+   m_shards[shardOf(securityId)]->cancelOrdersForSecIdWithMinimumQty(securityId, minQty);
+}
+
+// return the total qty that can match for the security id
+unsigned ShardedOrderCacheImpl::getMatchingSizeForSecurity(const std::string& securityId) {
+   return matchingSize(securityId);
+}
+
+//
+unsigned ShardedOrderCacheImpl::matchingSize(std::string_view securityId) const {
+   return m_shards[shardOf(securityId)]->matchingSize(securityId);
+}
+
+//
+OrderCacheImpl::SideQty ShardedOrderCacheImpl::getOutstandingQtyForUser(std::string_view user) const {
+   OrderCacheImpl::SideQty total;
+   for (auto& shard : m_shards) {
+      OrderCacheImpl::SideQty qty = shard->getOutstandingQtyForUser(user);
+      total._buy += qty._buy;
+      total._sell += qty._sell;
+   }
+   return total;
+}
+
+//
+OrderCacheImpl::SideQty ShardedOrderCacheImpl::getOutstandingQtyForCompany(std::string_view company) const {
+   OrderCacheImpl::SideQty total;
+   for (auto& shard : m_shards) {
+      OrderCacheImpl::SideQty qty = shard->getOutstandingQtyForCompany(company);
+      total._buy += qty._buy;
+      total._sell += qty._sell;
+   }
+   return total;
+}
+
+//
+void ShardedOrderCacheImpl::subscribe(OrderSubscriber* subscriber, unsigned events) {
+   for (auto& shard : m_shards)
+      shard->subscribe(subscriber, events);
+}
+
+//
+void ShardedOrderCacheImpl::unsubscribe(OrderSubscriber* subscriber) {
+   for (auto& shard : m_shards)
+      shard->unsubscribe(subscriber);
+}
+
+//
+void ShardedOrderCacheImpl::dumpStats(std::ostream& out) const {
+   for (unsigned i = 0; i < m_shards.size(); i++) {
+      out << "shard " << i << ":\n";
+      m_shards[i]->dumpStats(out);
+   }
+}
+
+//
+OrderSnapshot ShardedOrderCacheImpl::snapshot() const {
+   OrderSnapshot snap;
+   for (auto& shard : m_shards)
+      snap.append(shard->snapshot());
+   return snap;
+}
+
+// strings are copied after all the shard locks are released
+std::vector<Order> ShardedOrderCacheImpl::getAllOrders() const {
+   return snapshot().toOrders();
+}
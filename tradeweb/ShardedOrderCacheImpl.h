@@ -0,0 +1,134 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+#include "OrderCacheImpl.h"
+
+// Sharded cache mode:
+//   1. Securities are partitioned across N shards, every shard is a complete OrderCacheImpl
+//      with its own lock, so writers on one security block only readers of the same shard
+//   2. Since cancelOrder() knows only the order id, there is a directory orderId -> shard.
+//      The directory is split into stripes, each with its own mutex.
+//      Shards maintain it through OrderDirectory hooks, under their own write lock.
+//      The stripes keep user -> company too: the user's orders go to different shards, but the user
+//      belongs to the company of the first order the whole cache has got, as in OrderCacheImpl.
+//      The shard, which sees the user first time, takes the company from the stripe of the user
+//   3. Locking rules:
+//       - a thread holds at most one shard lock and at most one directory stripe at a time;
+//       - when both are needed, the shard lock is always acquired first;
+//       - cancelOrder() looks the shard up under the stripe, releases it, then goes to the shard.
+//         If the order was cancelled meanwhile, the shard just doesn't find it;
+//       - cross-shard operations (cancelOrdersForUser, getAllOrders, batches) visit shards
+//         one by one in ascending shard index order and never hold two shard locks.
+//         Bulk cancels on the large cache go to the shards in parallel on WorkerPool - every
+//         worker still holds single shard lock at a time, so the rules above hold for them.
+//      As a result getAllOrders() is consistent per shard (thus per security), but not
+//      an atomic snapshot of the whole cache while writers are running
+//   4. getMatchingSizeForSecurity() takes no lock at all - neither shard nor directory one,
+//      it reads the size published by the shard (see MatchingTable)
+//   5. Subscribers get the batches of every shard separately - in the order of the writes
+//      per shard (thus per security), _seq of OrderChanges is counted per shard
+
+//
+class ShardedOrderCacheImpl : public OrderCacheInterface {
+public:
+   // 0 - use number of hardware threads
+   explicit ShardedOrderCacheImpl(unsigned shards = 0);
+
+   // add order to the cache
+   virtual void addOrder(Order order);
+
+   // remove order with this unique order id from the cache
+   virtual void cancelOrder(const std::string& orderId);
+
+   // remove all orders in the cache for this user
+   virtual void cancelOrdersForUser(const std::string& user);
+
+   // remove all orders in the cache for this security with qty >= minQty
+   virtual void cancelOrdersForSecIdWithMinimumQty(const std::string& securityId, unsigned int minQty);
+
+   // return the total qty that can match for the security id
+   virtual unsigned int getMatchingSizeForSecurity(const std::string& securityId);
+   unsigned matchingSize(std::string_view securityId) const;
+
+   // sums of the shards
+   OrderCacheImpl::SideQty getOutstandingQtyForUser(std::string_view user) const;
+   OrderCacheImpl::SideQty getOutstandingQtyForCompany(std::string_view company) const;
+
+   // return all orders in cache in a vector
+   virtual std::vector<Order> getAllOrders() const;
+
+   // sum of the shards, without any lock
+   std::size_t size() const;
+
+   // batch versions - orders are grouped by shard, each shard is locked once.
+   // If the batch has the same order id twice, the one for the lower shard wins,
+   // the same for the company of the user, who is new to the cache
+   void addOrders(std::span<const Order> orders);
+   void addOrders(std::span<const OrderView> orders);
+   void cancelOrders(std::span<const std::string> orderIds);
+   void cancelOrders(std::span<const std::string_view> orderIds);
+
+   // shard snapshots taken one by one - consistent per shard only, see above
+   OrderSnapshot snapshot() const;
+
+   // walks the shards one by one, each under its read lock
+   template <class Visitor>
+   void forEachOrder(Visitor&& visit) const {
+      for (auto& shard : m_shards)
+         shard->forEachOrder(visit);
+   }
+
+   // subscribes to every shard, see above
+   void subscribe(OrderSubscriber* subscriber, unsigned events = eventAll);
+   void unsubscribe(OrderSubscriber* subscriber);
+
+   // statistics of the shards one by one, see OrderCacheStats.h
+   void dumpStats(std::ostream& out) const;
+
+   unsigned shardCount() const { return static_cast<unsigned>(m_shards.size()); }
+
+private:
+   static constexpr unsigned noShard = ~0u;
+
+   unsigned shardOf(std::string_view securityId) const;
+
+   // task(shard) for every shard, in parallel on WorkerPool::shared(), if asked
+   void forEachShard(bool parallel, const std::function<void(std::size_t)>& task);
+
+   // the shard, which keeps the order, noShard - no such order
+   unsigned findShard(std::string_view orderId);
+
+   struct alignas(64) DirStripe {
+      std::mutex _lock;
+      NodePool _pool;
+      StrMap<unsigned> _shards{&_pool}; // orderId -> shard index
+      StrMap<SymbolTable::Id> _users{&_pool}; // user -> company in _comps, never removed
+      SymbolTable _comps{&_pool};
+   };
+
+   // of the order id, or of the user
+   DirStripe& stripeOf(std::string_view key);
+
+   // OrderDirectory of the single shard
+   class ShardDirectory : public OrderDirectory {
+   public:
+      ShardDirectory(ShardedOrderCacheImpl& owner, unsigned shard) : m_owner(owner), m_shard(shard) {}
+
+      virtual bool claim(std::string_view orderId);
+      virtual void release(std::string_view orderId);
+      virtual std::string_view company(std::string_view user, std::string_view company);
+
+   private:
+      ShardedOrderCacheImpl& m_owner;
+      unsigned m_shard;
+   };
+
+   // hooks are declared before the shards, which use them
+   std::vector<std::unique_ptr<ShardDirectory>> m_hooks;
+   std::vector<std::unique_ptr<OrderCacheImpl>> m_shards;
+   std::vector<std::unique_ptr<DirStripe>> m_dir;
+};
@@ -0,0 +1,54 @@
+#include "SymbolTable.h"
+
+//
+std::pair<SymbolTable::Id, bool> SymbolTable::insert(std::string_view s) {
+   auto found = m_ids.find(s);
+   if (m_ids.end() != found)
+      return {found->second, false};
+   Id id;
+   if (!m_free.empty()) {
+      id = m_free.back();
+      m_free.pop_back();
+   }
+   else {
+      id = static_cast<Id>(m_names.size());
+      m_names.emplace_back();
+   }
+   m_names[id].assign(s);
+#ifdef ORDERCACHE_STD_HASH
+   std::size_t buckets = m_ids.bucket_count();
+   m_ids.try_emplace(std::string_view(m_names[id]), id);
+   m_rehashes += buckets != m_ids.bucket_count();
+#else
+   m_ids.try_emplace(std::string_view(m_names[id]), id);
+#endif
+   return {id, true};
+}
+
+//
+void SymbolTable::reserve(std::size_t symbols) {
+#ifdef ORDERCACHE_STD_HASH
+   std::size_t buckets = m_ids.bucket_count();
+   m_ids.reserve(symbols);
+   m_rehashes += buckets != m_ids.bucket_count();
+#else
+   m_ids.reserve(symbols);
+#endif
+}
+
+//
+SymbolTable::Id SymbolTable::find(std::string_view s) const {
+   auto found = m_ids.find(s);
+   return m_ids.end() == found ? none : found->second;
+}
+
+//
+void SymbolTable::retire(Id id) {
+   m_ids.erase(std::string_view(m_names[id]));
+}
+
+//
+void SymbolTable::recycle(Id id) {
+   m_names[id].clear();
+   m_free.push_back(id);
+}
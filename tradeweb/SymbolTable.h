@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <functional>
+
+#include "HashMap.h"
+
+// transparent hash - lets cxx20 find() search std::string keys by std::string_view
+// without constructing temporary string
+struct StrHash {
+   using is_transparent = void;
+
+   std::size_t operator()(std::string_view s) const noexcept {
+      return std::hash<std::string_view>{}(s);
+   }
+};
+
+template <class T>
+using StrMap = HashMap<std::string, T, StrHash, std::equal_to<>>;
+
+// Interns strings into dense 32-bit ids:
+//   - ids are the indexes in m_names, so they can be used as vector indexes by the owner
+//   - released ids are recycled by the next insert(), so the table stays dense even for
+//     the symbols with short life (order ids)
+//   - the names are kept just once in m_names, which never moves them,
+//     the index keeps std::string_view of them
+//   - not thread safe, the owner protects it
+class SymbolTable {
+public:
+   using Id = std::uint32_t;
+
+   static constexpr Id none = ~Id(0);
+
+   // nodes of the index are taken from the pool, if it's given
+   explicit SymbolTable(NodePool* pool = nullptr) : m_ids(pool) {}
+
+   // returns id of the string and true if it was just added
+   std::pair<Id, bool> insert(std::string_view s);
+
+   Id intern(std::string_view s) { return insert(s).first; }
+
+   // returns none if there is no such string, never allocates
+   Id find(std::string_view s) const;
+
+   // prepares the table for the given total number of symbols
+   void reserve(std::size_t symbols);
+
+   // the symbol is not used anymore, id may be given to another string
+   void release(Id id) {
+      retire(id);
+      recycle(id);
+   }
+
+   // two halves of release(): retire() removes the string from the index, but keeps it
+   // in place for the readers, which still refer it, recycle() gives the id to the next insert()
+   void retire(Id id);
+   void recycle(Id id);
+
+   const std::string& name(Id id) const { return m_names[id]; }
+
+   // upper bound of ids, including released ones
+   std::size_t capacity() const { return m_names.size(); }
+
+   std::size_t size() const { return m_ids.size(); }
+
+   // of the index - for the statistics
+   std::size_t buckets() const { return m_ids.bucket_count(); }
+   double loadFactor() const { return m_ids.load_factor(); }
+
+   // times the index was rebuilt, including the ones, which keep its size (FlatHashMap cleans
+   // the tombstones so). std::unordered_map doesn't count them, the table does it for it
+#ifdef ORDERCACHE_STD_HASH
+   std::size_t rehashes() const { return m_rehashes; }
+#else
+   std::size_t rehashes() const { return m_ids.rehashes(); }
+#endif
+
+private:
+   HashMap<std::string_view, Id, StrHash, std::equal_to<>> m_ids;
+   std::deque<std::string> m_names; // released ones are cleared, but keep their buffers for the next symbol
+   std::vector<Id> m_free;
+#ifdef ORDERCACHE_STD_HASH
+   std::size_t m_rehashes = 0; // every rehash of std::unordered_map changes the number of buckets
+#endif
+};
@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "WorkerPool.h"
+
+//
+WorkerPool::WorkerPool(unsigned threads) {
+   if (!threads)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+   for (unsigned i = 1; i < threads; i++)
+      m_workers.emplace_back([this] { work(); });
+}
+
+//
+WorkerPool::~WorkerPool() {
+   {
+      std::lock_guard<std::mutex> gl(m_lock);
+      m_stop = true;
+   }
+   m_wake.notify_all();
+   for (auto& w : m_workers)
+      w.join();
+}
+
+//
+WorkerPool& WorkerPool::shared() {
+   static WorkerPool pool;
+   return pool;
+}
+
+//
+void WorkerPool::run(std::size_t parts, const std::function<void(std::size_t)>& task) {
+   std::unique_lock<std::mutex> gb(m_busy, std::try_to_lock);
+   if (parts < 2 || m_workers.empty() || !gb.owns_lock()) {
+      for (std::size_t i = 0; i < parts; i++)
+         task(i);
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> gl(m_lock);
+      m_task = &task;
+      m_parts = parts;
+      m_next = 0;
+      m_error = nullptr;
+      m_job++;
+   }
+   m_wake.notify_all();
+   runParts();
+   std::unique_lock<std::mutex> gl(m_lock);
+   m_done.wait(gl, [this] { return !m_active; });
+   m_task = nullptr; // late workers see no job
+   if (m_error)
+      std::rethrow_exception(m_error);
+}
+
+//
+void WorkerPool::runParts() {
+   for (std::size_t i; (i = m_next.fetch_add(1)) < m_parts;) {
+      try {
+         (*m_task)(i);
+      }
+      catch (...) {
+         std::lock_guard<std::mutex> gl(m_lock);
+         if (!m_error)
+            m_error = std::current_exception();
+      }
+   }
+}
+
+// the worker joins the job only while it's running - run() waits just for the joined ones
+void WorkerPool::work() {
+   std::uint64_t seen = 0;
+   std::unique_lock<std::mutex> gl(m_lock);
+   for (;;) {
+      m_wake.wait(gl, [&] { return m_stop || (m_task && m_job != seen); });
+      if (m_stop)
+         return;
+      seen = m_job;
+      m_active++;
+      gl.unlock();
+      runParts();
+      gl.lock();
+      if (!--m_active)
+         m_done.notify_all();
+   }
+}
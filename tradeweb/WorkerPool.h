@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads for the bulk operations of the caches (getAllOrders(), cancels across shards):
+//   - run(n, task) calls task(i) for every i in [0, n) and returns when all are done,
+//     the calling thread takes the parts as well, the workers take the next free part;
+//   - single job at a time - a run() from another thread or from the task itself, while
+//     the pool is busy, goes in the calling thread, so it never waits for the pool;
+//   - the first exception of the parts is rethrown by run(), the rest of the parts still go
+class WorkerPool {
+public:
+   // 0 - hardware threads, the calling thread is one of them
+   explicit WorkerPool(unsigned threads = 0);
+   ~WorkerPool();
+
+   WorkerPool(const WorkerPool&) = delete;
+   WorkerPool& operator=(const WorkerPool&) = delete;
+
+   // threads, which run the parts, including the calling one
+   unsigned size() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+   void run(std::size_t parts, const std::function<void(std::size_t)>& task);
+
+   // the pool of the caches
+   static WorkerPool& shared();
+
+private:
+   void work();
+   void runParts(); // takes the parts of the current job till they're over
+
+   std::vector<std::thread> m_workers;
+   std::mutex m_busy; // taken by run() for the whole job
+
+   // the current job, under m_lock
+   std::mutex m_lock;
+   std::condition_variable m_wake;
+   std::condition_variable m_done;
+   const std::function<void(std::size_t)>* m_task = nullptr;
+   std::size_t m_parts = 0;
+   std::atomic<std::size_t> m_next{0};
+   std::uint64_t m_job = 0;  // number of the job, the workers wait for the next one
+   unsigned m_active = 0;    // workers, which run the parts of the current job
+   std::exception_ptr m_error;
+   bool m_stop = false;
+};
@@ -1,13 +1,17 @@
 #include <iostream>
+#include <chrono>
+#include <cstdio>
 #include <string>
 #include <memory>
 #include <vector>
 #include <set>
 
-#include "include/cpp20/unordered_set" // see test()
-#include "include/cpp20/unordered_map" // see test()
-
 #include "OrderCacheImpl.h"
+#include "OrderCacheBench.h"
+#include "OrderCacheCheck.h"
+#include "OrderCacheStress.h"
+#include "OrderFeed.h"
+#include "OrderJournal.h"
 
 using namespace std::string_literals;
 
@@ -15,88 +19,6 @@ using std::cout; using std::cin; using std::endl;
 using std::string;
 using std::vector;
 
-using StrShared = std::shared_ptr<string>;
-
-struct StrSharedEqual {
-   using is_transparent = void; // for find() override
-
-   bool operator()(const StrShared& ss1, const StrShared& ss2) const  noexcept {
-      return *ss1 == *ss2;
-   }
-   bool operator()(const string& s1, const StrShared& ss2) const  noexcept {
-      return s1 == *ss2;
-   }
-   bool operator()(const StrShared& ss1, const string& s2) const  noexcept {
-      return *ss1 == s2;
-   }
-};
-
-//
-struct StrSharedHash {
-   using is_transparent = void; // for find() override
-
-   std::size_t operator()(const StrShared& ss) const noexcept {
-      return std::hash<string>{}(*ss); 
-   }
-
-   std::size_t operator()(const std::string& s) const noexcept {
-      return std::hash<string>{}(s);
-   }
-};
-
-using PtrStrSet = std::unordered_set<StrShared, StrSharedHash, StrSharedEqual>;
-
-using PtrStrIntMap = std::unordered_map<StrShared, int, StrSharedHash, StrSharedEqual>;
-
-//
-int test()
-{
-   string s1 = "Serg"s;
-   auto ss1 = std::make_shared<string>(s1);
-   // testing set with cxx20
-   PtrStrSet pss;
-   auto resS = pss.insert(ss1);
-   cout << "Inserted: " << (resS.second? "yes" : "no") << endl;
-   auto foundS = pss.find(s1);
-   cout << "Found: ";
-   if (foundS != pss.end())
-      cout << "yes: " << **foundS << endl;
-   else
-      cout << "no" << endl;
-
-   // testing map with cxx20
-   PtrStrIntMap msi1;
-   auto resM = msi1.insert({ss1, 2});
-   cout << "Inserted: " << (resM.second ? "yes" : "no") << endl;
-   auto foundM = msi1.find(s1);
-   cout << "Found: ";
-   if (foundM != msi1.end())
-      cout << "yes: " << (*foundM).second << endl;
-   else
-      cout << "no" << endl;
-
-   return 0;
-}
-
-using VecStr = vector<string>;
-
-// splitting the string to tokens
-VecStr split(const string& str, const string& delim) {
-   VecStr tokens;
-   size_t prev = 0, pos = 0;
-   do {
-      pos = str.find(delim, prev);
-      if (pos == string::npos)
-         pos = str.length();
-      string token = str.substr(prev, pos - prev);
-      if (!token.empty())
-         tokens.push_back(std::move(token));
-      prev = pos + delim.length();
-   }
-   while (pos < str.length() && prev < str.length());
-   return tokens;
-}
-
 using VecOrders = vector<Order>;
 
 //
@@ -118,26 +40,85 @@ void getAndPrintOrders(const OrderCacheImpl& orders) {
    printOrders(ordAll);
 }
 
+// replays the events of the file ("-" or none - stdin) through OrderFeed, see OrderFeed.h.
+// With the journal base the cache is recovered first and checkpointed at the end, see OrderJournal.h
+int replay(int argc, char* argv[]) {
+   std::FILE* in = stdin;
+   if (argc > 2 && "-"s != argv[2] && !(in = std::fopen(argv[2], "rb"))) {
+      std::cerr << "can't open " << argv[2] << endl;
+      return 1;
+   }
+   OrderCacheImpl orders;
+   std::unique_ptr<OrderJournal> journal;
+   if (argc > 3) {
+      journal = std::make_unique<OrderJournal>(argv[3]);
+      auto start = std::chrono::steady_clock::now();
+      if (!journal->recover(orders)) {
+         std::cerr << "can't recover from " << argv[3] << endl;
+         return 1;
+      }
+      std::cerr << "recovered " << journal->recovered() << " orders from the snapshot, "
+                << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << endl;
+   }
+   CacheFeed<OrderCacheImpl> feed(orders, &cout);
+   OrderFeed parser(feed);
+   auto start = std::chrono::steady_clock::now();
+   bool ok = false;
+   try {
+      ok = parser.run(in);
+   }
+   catch (const string& e) { // the journal has failed
+      std::cerr << "replay has stopped: " << e << endl;
+      return 1;
+   }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   if (stdin != in)
+      std::fclose(in);
+   const FeedStats& stats = parser.stats();
+   std::size_t events = 0;
+   for (std::size_t n : stats._events)
+      events += n;
+   std::cerr << "lines " << stats._lines << ", adds " << stats._events[feedAdd] << ", cancels " << stats._events[feedCancel]
+             << ", user cancels " << stats._events[feedCancelUser] << ", security cancels " << stats._events[feedCancelSecMinQty]
+             << ", queries " << stats._events[feedQuery] << ", errors " << stats._errors;
+   if (stats._errors)
+      std::cerr << " (first at line " << stats._firstError << ")";
+   std::cerr << endl << seconds << " s, " << events / (seconds > 0 ? seconds : 1) << " events/s" << endl;
+   if constexpr (OrderCacheStats::enabled)
+      orders.dumpStats(std::cerr);
+   if (journal && !journal->checkpoint(orders)) {
+      std::cerr << "checkpoint failed" << endl;
+      return 1;
+   }
+   return ok ? 0 : 1;
+}
+
 //
-int main() {
+int main(int argc, char* argv[]) {
+   if (argc > 1 && "bench"s == argv[1])
+      return runBenchmark(argc, argv);
+   if (argc > 1 && "stress"s == argv[1])
+      return runStress(argc, argv);
+   if (argc > 1 && "replay"s == argv[1])
+      return replay(argc, argv);
+   if (argc > 1 && "check"s == argv[1])
+      return runCheck();
    OrderCacheImpl orders;
-   std::set<string> comps, users, secs;
-   VecStr vecOrders;
-   // read input from standard input
-   string line;
-   while (true) {
-      std::getline(cin, line);
-      // there is a confusion in text descrption and example input
-      // lets tolerate for that
-      if (line.empty())
-         break;
-      VecStr order = split(line, " "s);
-      Order ord(order[0], order[1], order[2], std::stoul(order[3]), order[4], order[5]);
-      orders.addOrder(ord);
-      comps.insert(ord.company());
+   // read input from standard input, the order block ends with the blank line as before,
+   // "tradeweb replay" reads the whole stream
+   CacheFeed<OrderCacheImpl> feed(orders, &cout);
+   OrderFeed parser(feed);
+   string block, line;
+   while (std::getline(cin, line) && !line.empty())
+      block += line + '\n';
+   parser.parse(block, true);
+   VecOrders ordAll = orders.getAllOrders();
+   if (ordAll.empty())
+      return 0;
+   std::set<string> users, secs;
+   for (auto& ord : ordAll) {
       users.insert(ord.user());
       secs.insert(ord.securityId());
-      vecOrders.push_back(ord.orderId());
    }
    getAndPrintOrders(orders);
    // test getMatchingSizeForSecurity()
@@ -150,7 +131,7 @@ int main() {
    cout << "cancelOrdersForSecIdWithMinimumQty: " << secFst << ", 500" << endl;
    orders.cancelOrdersForSecIdWithMinimumQty(secFst, 500);
    getAndPrintOrders(orders);
-   string ordFst = vecOrders.front();
+   string ordFst = ordAll.front().orderId();
    cout << "cancelOrder: " << ordFst << endl;
    orders.cancelOrder(ordFst);
    string userFst = *users.begin();